@@ -0,0 +1,83 @@
+// This is copyrighted software. More information is at the end of this file.
+#include "Aulib/Decoder.h"
+#include "Aulib/ResamplerSpeex.h"
+#include "Aulib/Stream.h"
+#include "aulib.h"
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <memory>
+
+/*
+ * Renders an audio file into a WAV file without opening an audio device and prints how much faster
+ * than real time this was. Usage: render <input> <output.wav> [max seconds]
+ */
+
+using namespace Aulib;
+
+auto main(int argc, char* argv[]) -> int
+{
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <input> <output.wav> [max seconds]\n";
+        return 1;
+    }
+    const auto max_secs = argc > 3 ? std::atoi(argv[3]) : 600;
+    constexpr int rate = 44100;
+
+    if (not initOffline(rate, AUDIO_S16LSB, 2, 4096)) {
+        std::cerr << "Failed to initialize.\n";
+        return 1;
+    }
+
+    auto decoder = Decoder::decoderFor(argv[1]);
+    if (decoder == nullptr) {
+        std::cerr << "No decoder found.\n";
+        Aulib::quit();
+        return 1;
+    }
+
+    Stream stream(argv[1], std::move(decoder), std::make_unique<ResamplerSpeex>());
+    if (not stream.play()) {
+        std::cerr << "Failed to play input.\n";
+        Aulib::quit();
+        return 1;
+    }
+
+    const auto start = std::clock();
+    const auto frames = renderToFile(argv[2], std::chrono::seconds(max_secs));
+    const auto cpu_secs = static_cast<double>(std::clock() - start) / CLOCKS_PER_SEC;
+    Aulib::quit();
+
+    if (frames < 0) {
+        std::cerr << "Failed to write " << argv[2] << ".\n";
+        return 1;
+    }
+    const auto audio_secs = static_cast<double>(frames) / rate;
+    std::cout << "Rendered " << audio_secs << "s of audio in " << cpu_secs << "s of CPU time";
+    if (cpu_secs > 0) {
+        std::cout << " (" << audio_secs / cpu_secs << "x real time)";
+    }
+    std::cout << ".\n";
+}
+
+/*
+
+Copyright (C) 2014, 2015, 2016, 2017, 2018, 2019 Nikos Chantziaras.
+
+This file is part of SDL_audiolib.
+
+SDL_audiolib is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the Free
+Software Foundation, either version 3 of the License, or (at your option) any
+later version.
+
+SDL_audiolib is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with SDL_audiolib. If not, see <http://www.gnu.org/licenses/>.
+
+*/
@@ -0,0 +1,222 @@
+// This is copyrighted software. More information is at the end of this file.
+#include "Aulib/Decoder.h"
+#include "Aulib/ResamplerSdl.h"
+#include "Aulib/ResamplerSpeex.h"
+#include "aulib_config.h"
+#if USE_RESAMP_SRC
+#include "Aulib/ResamplerSrc.h"
+#endif
+#if USE_RESAMP_SOXR
+#include "Aulib/ResamplerSox.h"
+#endif
+#include <cmath>
+#include <ctime>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+ * Measures the CPU time each resampler needs to produce one second of audio. No audio device is
+ * opened; a generated sine sweep is resampled as fast as possible and the process CPU time is
+ * divided by the amount of audio that was produced.
+ */
+
+using namespace Aulib;
+
+namespace {
+
+constexpr int dstRate = 48000;
+constexpr int channels = 2;
+constexpr int chunkFrames = 1024;
+constexpr int benchSeconds = 60;
+constexpr double pi = 3.14159265358979323846;
+
+// Stereo sine sweep from 100Hz to 10kHz over ten seconds, repeated forever.
+class SweepDecoder final: public Decoder
+{
+public:
+    explicit SweepDecoder(int rate)
+        : fRate(rate)
+    {}
+
+    auto open(SDL_RWops* /*rwops*/) -> bool override
+    {
+        setIsOpen(true);
+        return true;
+    }
+
+    auto getChannels() const -> int override
+    {
+        return channels;
+    }
+
+    auto getRate() const -> int override
+    {
+        return fRate;
+    }
+
+    auto rewind() -> bool override
+    {
+        fFrame = 0;
+        return true;
+    }
+
+    auto duration() const -> std::chrono::microseconds override
+    {
+        return {};
+    }
+
+    auto seekToTime(std::chrono::microseconds /*pos*/) -> bool override
+    {
+        return false;
+    }
+
+protected:
+    auto doDecoding(float buf[], int len, bool& /*callAgain*/) -> int override
+    {
+        const int sweepFrames = fRate * 10;
+        for (int i = 0; i < len; i += channels) {
+            const double t = static_cast<double>(fFrame % sweepFrames) / fRate;
+            const double freq = 100.0 * std::pow(100.0, t / 10.0);
+            fPhase += 2.0 * pi * freq / fRate;
+            const auto sample = static_cast<float>(0.5 * std::sin(fPhase));
+            buf[i] = sample;
+            buf[i + 1] = sample;
+            ++fFrame;
+        }
+        return len;
+    }
+
+private:
+    int fRate;
+    long long fFrame = 0;
+    double fPhase = 0.0;
+};
+
+struct Backend final
+{
+    std::string name;
+    std::function<std::unique_ptr<Resampler>()> create;
+};
+
+auto backends() -> std::vector<Backend>
+{
+    std::vector<Backend> list;
+    for (int quality : {0, 3, 5, 8, 10}) {
+        list.push_back({"Speex " + std::to_string(quality),
+                        [quality] { return std::make_unique<ResamplerSpeex>(quality); }});
+    }
+#if SDL_VERSION_ATLEAST(2, 0, 7)
+    list.push_back({"SDL", [] { return std::make_unique<ResamplerSdl>(); }});
+#endif
+#if USE_RESAMP_SRC
+    list.push_back({"SRC linear", [] {
+                        return std::make_unique<ResamplerSrc>(ResamplerSrc::Quality::Linear);
+                    }});
+    list.push_back({"SRC sinc fastest", [] {
+                        return std::make_unique<ResamplerSrc>(ResamplerSrc::Quality::SincFastest);
+                    }});
+    list.push_back({"SRC sinc medium", [] {
+                        return std::make_unique<ResamplerSrc>(ResamplerSrc::Quality::SincMedium);
+                    }});
+    list.push_back({"SRC sinc best", [] {
+                        return std::make_unique<ResamplerSrc>(ResamplerSrc::Quality::SincBest);
+                    }});
+#endif
+#if USE_RESAMP_SOXR
+    list.push_back({"SoX quick", [] {
+                        return std::make_unique<ResamplerSox>(ResamplerSox::Quality::Quick);
+                    }});
+    list.push_back({"SoX low", [] {
+                        return std::make_unique<ResamplerSox>(ResamplerSox::Quality::Low);
+                    }});
+    list.push_back({"SoX medium", [] {
+                        return std::make_unique<ResamplerSox>(ResamplerSox::Quality::Medium);
+                    }});
+    list.push_back({"SoX high", [] {
+                        return std::make_unique<ResamplerSox>(ResamplerSox::Quality::High);
+                    }});
+    list.push_back({"SoX very high", [] {
+                        return std::make_unique<ResamplerSox>(ResamplerSox::Quality::VeryHigh);
+                    }});
+#endif
+    return list;
+}
+
+// Returns the CPU time in milliseconds needed to produce one second of output, or a negative
+// value if the resampler failed.
+auto measure(const Backend& backend, int srcRate) -> double
+{
+    auto resampler = backend.create();
+    resampler->setDecoder(std::make_shared<SweepDecoder>(srcRate));
+    if (resampler->setSpec(dstRate, channels, chunkFrames) != 0) {
+        return -1.0;
+    }
+
+    std::vector<float> buf(chunkFrames * channels);
+    const long long totalSamples = static_cast<long long>(benchSeconds) * dstRate * channels;
+    long long done = 0;
+    const std::clock_t start = std::clock();
+    while (done < totalSamples) {
+        const int len = resampler->resample(buf.data(), static_cast<int>(buf.size()));
+        if (len <= 0) {
+            return -1.0;
+        }
+        done += len;
+    }
+    const double cpuMs = 1000.0 * static_cast<double>(std::clock() - start) / CLOCKS_PER_SEC;
+    return cpuMs / (static_cast<double>(done) / (dstRate * channels));
+}
+
+} // namespace
+
+auto main() -> int
+{
+    const std::vector<int> srcRates{11025, 22050, 44100};
+
+    std::cout << "CPU time in ms per second of " << dstRate << "Hz stereo output.\n\n";
+    std::cout << std::left << std::setw(20) << "Resampler";
+    for (int rate : srcRates) {
+        std::cout << std::right << std::setw(12) << (std::to_string(rate) + "Hz");
+    }
+    std::cout << '\n';
+
+    for (const auto& backend : backends()) {
+        std::cout << std::left << std::setw(20) << backend.name << std::right << std::fixed
+                  << std::setprecision(3);
+        for (int rate : srcRates) {
+            const double ms = measure(backend, rate);
+            if (ms < 0) {
+                std::cout << std::setw(12) << "failed";
+            } else {
+                std::cout << std::setw(12) << ms;
+            }
+            std::cout.flush();
+        }
+        std::cout << '\n';
+    }
+}
+
+/*
+
+Copyright (C) 2014, 2015, 2016, 2017, 2018, 2019 Nikos Chantziaras.
+
+This file is part of SDL_audiolib.
+
+SDL_audiolib is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the Free
+Software Foundation, either version 3 of the License, or (at your option) any
+later version.
+
+SDL_audiolib is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with SDL_audiolib. If not, see <http://www.gnu.org/licenses/>.
+
+*/
@@ -0,0 +1,274 @@
+// This is copyrighted software. More information is at the end of this file.
+#include "sampleconv.h"
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+ * Checks that every SIMD sample conversion and mixing kernel produces exactly the same bits as the
+ * scalar one, then measures how fast each of them is. With --check, only the check is done. The
+ * exit status is non-zero if any kernel doesn't match.
+ */
+
+using namespace Aulib;
+
+namespace {
+
+// Lengths to check. Most of them aren't a multiple of any vector width, so the scalar tails of
+// the SIMD kernels get exercised too.
+const std::vector<int> checkLengths{0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 33, 63, 1023, 1025};
+
+constexpr int benchLen = 4096;
+constexpr double benchSeconds = 0.25;
+
+// Values at and beyond the edges of the [-1, 1] range, where clipping and saturation happen.
+auto edgeValues() -> std::vector<float>
+{
+    constexpr float inf = std::numeric_limits<float>::infinity();
+    std::vector<float> values{0.f, -0.f, 1.f, -1.f, 0.5f, -0.5f, 2.f, -2.f, 1.5f, -1.5f,
+                              65535.f, -65535.f, 65536.f, -65536.f, 1e10f, -1e10f, inf, -inf,
+                              32767.f / 32768.f, -32767.f / 32768.f, 32767.5f / 32768.f,
+                              -32768.5f / 32768.f, std::numeric_limits<float>::denorm_min(),
+                              std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest()};
+    for (float edge : {1.f, -1.f}) {
+        values.push_back(std::nextafter(edge, 0.f));
+        values.push_back(std::nextafter(edge, 2.f * edge));
+    }
+    return values;
+}
+
+// Edge values first, then random values in [-range, range].
+auto makeFloats(std::mt19937& rng, const int len, const float range, const bool edges)
+    -> std::vector<float>
+{
+    std::uniform_real_distribution<float> dist(-range, range);
+    std::vector<float> buf(len);
+    const auto edge_values = edges ? edgeValues() : std::vector<float>();
+    for (int i = 0; i < len; ++i) {
+        buf[i] = i < static_cast<int>(edge_values.size()) ? edge_values[i] : dist(rng);
+    }
+    return buf;
+}
+
+auto makeS16(std::mt19937& rng, const int len) -> std::vector<Sint16>
+{
+    const Sint16 edges[] = {0, 1, -1, 32767, -32768, 32766, -32767};
+    std::uniform_int_distribution<int> dist(-32768, 32767);
+    std::vector<Sint16> buf(len);
+    for (int i = 0; i < len; ++i) {
+        buf[i] = i < static_cast<int>(std::size(edges)) ? edges[i] : static_cast<Sint16>(dist(rng));
+    }
+    return buf;
+}
+
+template <typename T>
+auto sameBits(const std::vector<T>& a, const std::vector<T>& b) -> bool
+{
+    return a.size() == b.size() and std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+}
+
+// Runs one operation with the given kernel set and returns the output bytes.
+struct Kernel final
+{
+    std::string name;
+    std::function<std::vector<Uint8>(const SampleKernelSet&, int len)> run;
+};
+
+template <typename T>
+auto toBytes(const std::vector<T>& v) -> std::vector<Uint8>
+{
+    std::vector<Uint8> bytes(v.size() * sizeof(T));
+    std::memcpy(bytes.data(), v.data(), bytes.size());
+    return bytes;
+}
+
+// Each operation generates its input from a seed derived from the length, so the reference and
+// the tested kernel see the same data.
+auto kernelList() -> std::vector<Kernel>
+{
+    std::vector<Kernel> list;
+    list.push_back({"floatToS16", [](const SampleKernelSet& k, const int len) {
+                        std::mt19937 rng(len);
+                        const auto src = makeFloats(rng, len, 1.5f, true);
+                        std::vector<Uint8> dst(len * 2);
+                        k.floatToS16(dst.data(), src.data(), len);
+                        return dst;
+                    }});
+    list.push_back({"floatToS32", [](const SampleKernelSet& k, const int len) {
+                        std::mt19937 rng(len);
+                        const auto src = makeFloats(rng, len, 1.5f, true);
+                        std::vector<Uint8> dst(len * 4);
+                        k.floatToS32(dst.data(), src.data(), len);
+                        return dst;
+                    }});
+    list.push_back({"mixWithGain", [](const SampleKernelSet& k, const int len) {
+                        std::mt19937 rng(len);
+                        const auto src = makeFloats(rng, len, 1.5f, true);
+                        auto dst = makeFloats(rng, len, 4.f, false);
+                        k.mixWithGain(dst.data(), src.data(), len, 0.7f, -0.3f);
+                        k.mixWithGain(dst.data(), src.data(), len, 1.f, 1.f / 3.f);
+                        return toBytes(dst);
+                    }});
+    list.push_back({"mixWithEnvelope", [](const SampleKernelSet& k, const int len) {
+                        std::mt19937 rng(len);
+                        const auto src = makeFloats(rng, len, 1.5f, true);
+                        const auto env = makeFloats(rng, len, 1.2f, false);
+                        auto dst = makeFloats(rng, len, 4.f, false);
+                        k.mixWithEnvelope(dst.data(), src.data(), env.data(), len, 0.7f, -0.3f);
+                        return toBytes(dst);
+                    }});
+    list.push_back({"s16ToFloat", [](const SampleKernelSet& k, const int len) {
+                        std::mt19937 rng(len);
+                        const auto src = makeS16(rng, len);
+                        std::vector<float> dst(len);
+                        k.s16ToFloat(dst.data(), src.data(), len);
+                        return toBytes(dst);
+                    }});
+    list.push_back({"monoToStereo", [](const SampleKernelSet& k, const int len) {
+                        std::mt19937 rng(len);
+                        auto buf = makeFloats(rng, len * 2, 1.5f, true);
+                        k.monoToStereo(buf.data(), len);
+                        return toBytes(buf);
+                    }});
+    list.push_back({"stereoToMono", [](const SampleKernelSet& k, const int len) {
+                        std::mt19937 rng(len);
+                        const auto src = makeFloats(rng, len * 2, 1.5f, true);
+                        std::vector<float> dst(len);
+                        k.stereoToMono(dst.data(), src.data(), len);
+                        return toBytes(dst);
+                    }});
+    return list;
+}
+
+auto check(const std::vector<SampleKernelSet>& sets) -> bool
+{
+    bool ok = true;
+    for (const auto& kernel : kernelList()) {
+        for (size_t i = 1; i < sets.size(); ++i) {
+            for (int len : checkLengths) {
+                const auto expected = kernel.run(sets[0], len);
+                const auto got = kernel.run(sets[i], len);
+                if (sameBits(expected, got)) {
+                    continue;
+                }
+                size_t pos = 0;
+                while (pos < got.size() and got[pos] == expected[pos]) {
+                    ++pos;
+                }
+                std::cout << sets[i].name << ' ' << kernel.name << ": mismatch at length " << len
+                          << ", byte " << pos << '\n';
+                ok = false;
+            }
+        }
+    }
+    return ok;
+}
+
+// Returns how many million samples per second the kernel processes.
+auto measure(const std::function<void()>& run) -> double
+{
+    long long samples = 0;
+    const std::clock_t start = std::clock();
+    std::clock_t now = start;
+    while (now - start < benchSeconds * CLOCKS_PER_SEC) {
+        for (int i = 0; i < 100; ++i) {
+            run();
+        }
+        samples += 100LL * benchLen;
+        now = std::clock();
+    }
+    return samples / (static_cast<double>(now - start) / CLOCKS_PER_SEC) / 1e6;
+}
+
+void bench(const std::vector<SampleKernelSet>& sets)
+{
+    std::mt19937 rng(0);
+    const auto src = makeFloats(rng, benchLen * 2, 1.f, false);
+    const auto env = makeFloats(rng, benchLen, 1.f, false);
+    const auto s16 = makeS16(rng, benchLen);
+    std::vector<float> dst(benchLen * 2);
+    std::vector<Uint8> bytes(benchLen * 4);
+
+    std::cout << "\nMillion samples per second, " << benchLen << " samples per call.\n\n";
+    std::cout << std::left << std::setw(18) << "Kernel";
+    for (const auto& set : sets) {
+        std::cout << std::right << std::setw(10) << set.name;
+    }
+    std::cout << '\n';
+
+    const std::vector<std::pair<std::string, std::function<void(const SampleKernelSet&)>>> ops{
+        {"floatToS16", [&](const SampleKernelSet& k) { k.floatToS16(bytes.data(), src.data(), benchLen); }},
+        {"floatToS32", [&](const SampleKernelSet& k) { k.floatToS32(bytes.data(), src.data(), benchLen); }},
+        {"mixWithGain",
+         [&](const SampleKernelSet& k) {
+             k.mixWithGain(dst.data(), src.data(), benchLen, 0.5f, 0.5f);
+         }},
+        {"mixWithEnvelope",
+         [&](const SampleKernelSet& k) {
+             k.mixWithEnvelope(dst.data(), src.data(), env.data(), benchLen, 0.5f, 0.5f);
+         }},
+        {"s16ToFloat", [&](const SampleKernelSet& k) { k.s16ToFloat(dst.data(), s16.data(), benchLen); }},
+        {"monoToStereo", [&](const SampleKernelSet& k) { k.monoToStereo(dst.data(), benchLen); }},
+        {"stereoToMono",
+         [&](const SampleKernelSet& k) { k.stereoToMono(dst.data(), src.data(), benchLen); }},
+    };
+    for (const auto& op : ops) {
+        std::cout << std::left << std::setw(18) << op.first << std::right << std::fixed
+                  << std::setprecision(0);
+        for (const auto& set : sets) {
+            std::cout << std::setw(10) << measure([&] { op.second(set); });
+            std::cout.flush();
+        }
+        std::cout << '\n';
+    }
+}
+
+} // namespace
+
+auto main(int argc, char* argv[]) -> int
+{
+    const auto sets = sampleKernelSets();
+    std::cout << "Kernels:";
+    for (const auto& set : sets) {
+        std::cout << ' ' << set.name;
+    }
+    std::cout << '\n';
+
+    const bool ok = check(sets);
+    std::cout << (ok ? "All kernels match the scalar ones.\n" : "Kernel mismatch.\n");
+    if (not ok) {
+        return 1;
+    }
+    if (argc > 1 and std::string(argv[1]) == "--check") {
+        return 0;
+    }
+    bench(sets);
+}
+
+/*
+
+Copyright (C) 2014, 2015, 2016, 2017, 2018, 2019 Nikos Chantziaras.
+
+This file is part of SDL_audiolib.
+
+SDL_audiolib is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the Free
+Software Foundation, either version 3 of the License, or (at your option) any
+later version.
+
+SDL_audiolib is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with SDL_audiolib. If not, see <http://www.gnu.org/licenses/>.
+
+*/
@@ -43,13 +43,22 @@ public:
     /*!
      * \brief Find and return an instance of the first decoder that can open the specified file.
      *
-     * All decoders known by SDL_Audiolib will be tried. If you want to try your own decoders or
-     * limit the list of tried decoders, then use the templated version of this function instead.
+     * All decoders known by SDL_Audiolib will be tried. The start of the file is read once and
+     * decoders whose magic bytes match it are tried first, so usually only one decoder has to open
+     * the file. If you want to try your own decoders or limit the list of tried decoders, then use
+     * the templated version of this function instead.
      *
      * \return A suitable decoder or nullptr if none of the decoders can open the file.
      */
     static auto decoderFor(const std::string& filename) -> std::unique_ptr<Decoder>;
-    //! \overload
+
+    /*!
+     * \overload
+     *
+     * The returned decoder has already been opened on \p rwops and must be used with that same
+     * rwops. The rwops position is left wherever the decoder put it. If no decoder can open the
+     * data, the rwops is rewound to its original position.
+     */
     static auto decoderFor(SDL_RWops* rwops) -> std::unique_ptr<Decoder>;
 
     auto isOpen() const -> bool;
@@ -62,6 +71,31 @@ public:
     virtual auto duration() const -> std::chrono::microseconds = 0;
     virtual auto seekToTime(std::chrono::microseconds pos) -> bool = 0;
 
+    /*!
+     * \brief Make decoding cheaper by one step.
+     *
+     * Called from the decoding thread of streams that have a load governor (see
+     * Stream::setLoadGovernor()) when decoding takes too long compared to the audio it produces.
+     * Decoders that synthesize their audio can trade quality for speed here, for example by
+     * playing fewer voices at once. The default implementation does nothing.
+     *
+     * \return
+     *  \retval true Decoding got cheaper.
+     *  \retval false Nothing was changed.
+     */
+    virtual auto reduceLoad() -> bool;
+
+    /*!
+     * \brief Undo one step of reduceLoad().
+     *
+     * Called when decoding has been comfortably fast for a while.
+     *
+     * \return
+     *  \retval true The quality was raised.
+     *  \retval false Nothing was changed. This is the case when running at full quality.
+     */
+    virtual auto restoreLoad() -> bool;
+
 protected:
     void setIsOpen(bool f);
     virtual auto doDecoding(float buf[], int len, bool& callAgain) -> int = 0;
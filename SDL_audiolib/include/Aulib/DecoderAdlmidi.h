@@ -104,6 +104,8 @@ public:
     auto rewind() -> bool override;
     auto duration() const -> std::chrono::microseconds override;
     auto seekToTime(std::chrono::microseconds pos) -> bool override;
+    auto reduceLoad() -> bool override;
+    auto restoreLoad() -> bool override;
 
 protected:
     auto doDecoding(float buf[], int len, bool& callAgain) -> int override;
@@ -23,7 +23,26 @@ public:
      */
     auto loadSoundfont(SDL_RWops* rwops) -> bool;
 
-    //! \overload
+    /*!
+     * \brief Load a soundfont that can be shared with other decoders.
+     *
+     * Synthesizers of destroyed decoders are kept around with their soundfont still loaded. If one
+     * of them has a soundfont with the same \p cacheKey, it is reused instead of loading the
+     * soundfont again. This only works if this is the only soundfont the decoder loads.
+     *
+     * Ownership of the \p rwops is transfered to the decoder.
+     *
+     * \return \c true on success, \c false if an error occurred.
+     */
+    auto loadSoundfont(SDL_RWops* rwops, const std::string& cacheKey) -> bool;
+
+    /*!
+     * \brief Load a soundfont from a file.
+     *
+     * The file name is used as the cache key. See loadSoundfont(SDL_RWops*, const std::string&).
+     *
+     * \return \c true on success, \c false if an error occurred.
+     */
     auto loadSoundfont(const std::string& filename) -> bool;
 
     /*!
@@ -50,6 +69,8 @@ public:
     auto rewind() -> bool override;
     auto duration() const -> std::chrono::microseconds override;
     auto seekToTime(std::chrono::microseconds pos) -> bool override;
+    auto reduceLoad() -> bool override;
+    auto restoreLoad() -> bool override;
 
 protected:
     auto doDecoding(float buf[], int len, bool& callAgain) -> int override;
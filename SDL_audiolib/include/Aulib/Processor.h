@@ -1,6 +1,7 @@
 // This is copyrighted software. More information is at the end of this file.
 #pragma once
 #include "aulib_export.h"
+#include <optional>
 
 namespace Aulib {
 
@@ -29,6 +30,23 @@ public:
      * \param[in] len Input and output buffer size in samples.
      */
     virtual void process(float dest[], const float source[], int len) = 0;
+
+    /*!
+     * \brief Returns whether process() can work in place.
+     *
+     * If this returns true, process() might get called with \p dest and \p source pointing to the
+     * same buffer, which saves the stream from having to switch buffers. The default is false.
+     */
+    virtual auto canProcessInPlace() const -> bool;
+
+    /*!
+     * \brief Returns the gain of a processor that does nothing but multiply samples by a constant.
+     *
+     * Processors that return a gain are not run at all. The stream applies the gain while mixing
+     * instead, or in one pass together with neighboring gain processors. All other processors must
+     * return an empty optional, which is the default.
+     */
+    virtual auto pureGain() const -> std::optional<float>;
 };
 
 } // namespace Aulib
@@ -110,6 +110,18 @@ public:
      */
     virtual auto play(int iterations = 1, std::chrono::microseconds fadeTime = {}) -> bool;
 
+    /*!
+     * \brief Start playback at an exact position of the device's sample clock.
+     *
+     * This works like play(), except that the first sample of the stream is mixed at the given
+     * device frame (see Aulib::deviceFrame().) Streams started for the same frame start in sync. If
+     * the frame has already been mixed, playback starts with the next period.
+     *
+     * play() schedules the stream one period after the current position of the device, so that
+     * the delay until it is heard is always the same.
+     */
+    auto playAt(Uint64 frame, int iterations = 1, std::chrono::microseconds fadeTime = {}) -> bool;
+
     /*!
      * \brief Stop playback.
      *
@@ -252,6 +264,105 @@ public:
      */
     virtual auto seekToTime(std::chrono::microseconds pos) -> bool;
 
+    /*!
+     * \brief Decode audio ahead of time in a background thread.
+     *
+     * Normally, the stream is decoded and resampled inside the audio callback. With decode-ahead
+     * enabled, a background thread keeps a buffer of decoded audio filled and the audio callback
+     * only mixes from it. This avoids dropouts with decoders that occasionally need a long time to
+     * produce audio (like MIDI synthesizers) at the cost of some memory and start latency. The loop
+     * callback is invoked when the loop point is decoded rather than when it is heard.
+     *
+     * The setting takes effect the next time play() is called.
+     *
+     * \param bufferLength
+     *  How much audio to keep decoded ahead. Zero disables decode-ahead.
+     *
+     * \param prefill
+     *  How much audio needs to be buffered before playback starts. Cannot be longer than
+     *  bufferLength.
+     */
+    void setDecodeAhead(std::chrono::milliseconds bufferLength,
+                        std::chrono::milliseconds prefill = {});
+
+    /*!
+     * \brief Lower the decoder's quality when decoding can't keep up.
+     *
+     * Only has an effect with decode-ahead. The decoding thread measures how long decoding takes
+     * compared to how long the produced audio plays. When it takes up too much of that time, the
+     * decoder is asked to make decoding cheaper (see Decoder::reduceLoad()), and when it's been
+     * fast for a while, to go back up again. MIDI synthesizers, for example, lower their
+     * polyphony.
+     *
+     * The setting takes effect the next time play() is called.
+     */
+    void setLoadGovernor(bool enabled);
+
+    /*!
+     * \brief Set the part of the stream that is repeated when looping.
+     *
+     * By default, the whole stream is looped. With a loop range, every iteration after the first
+     * starts at \p start, and every iteration except the last one ends at \p end. The last
+     * iteration plays on to the end of the stream.
+     *
+     * Loops are gapless. The start of the loop is kept decoded in memory and continues directly
+     * after the loop end, while the decoder seeks in a background thread to where the kept audio
+     * ends. How precisely it gets there depends on how accurately the decoder can seek.
+     *
+     * The setting takes effect the next time play() is called.
+     *
+     * \param start
+     *  Loop start, in sample frames of the decoded audio (before resampling.)
+     *
+     * \param end
+     *  Loop end, in sample frames. A negative value means the end of the stream.
+     */
+    void setLoopRange(Sint64 start, Sint64 end = -1);
+
+    /*!
+     * \brief Returns how many times the audio callback ran out of decoded audio.
+     *
+     * Only streams that decode ahead count underruns. The counter is reset by play().
+     */
+    auto underrunCount() const -> int;
+
+    /*!
+     * \brief Performance counters of a stream.
+     *
+     * See takeStats().
+     */
+    struct Stats final
+    {
+        //! Time spent in the decoder. For MIDI decoders, this is the time the synthesizer needed.
+        std::chrono::microseconds decodeTime{};
+
+        //! Time spent in the resampler, not counting the decoder.
+        std::chrono::microseconds resampleTime{};
+
+        //! Time spent in processors.
+        std::chrono::microseconds processTime{};
+
+        //! Time spent applying volume, fades and panning, and mixing into the output.
+        std::chrono::microseconds mixTime{};
+
+        /*!
+         * Lowest fill level of the decode-ahead buffer, in percent. -1 if the stream doesn't decode
+         * ahead.
+         */
+        int minAheadFill = -1;
+    };
+
+    /*!
+     * \brief Returns the stream's performance counters and resets them.
+     *
+     * Counters are only collected while Aulib::statsEnabled() is true. They cover the time since
+     * the previous call.
+     *
+     * For streams that decode ahead, decoding and resampling happens in the decode-ahead thread, so
+     * that time doesn't count against the audio callback.
+     */
+    auto takeStats() -> Stats;
+
     /*!
      * \brief Set a callback for when the stream finishes playback.
      *
@@ -4,6 +4,8 @@
 #include "aulib_global.h"
 #include <SDL_audio.h>
 #include <SDL_version.h>
+#include <array>
+#include <chrono>
 #include <string>
 
 #if !SDL_VERSION_ATLEAST(2, 0, 0)
@@ -82,6 +84,70 @@ AULIB_EXPORT auto init(int freq, AudioFormat format, int channels, int frameSize
  */
 AULIB_EXPORT auto initWithoutOutput(int freq, int channels) -> bool;
 
+/*!
+ * \brief Initializes the library for rendering audio without an audio device.
+ *
+ * Streams are used just like after \ref init(), but nothing is played. Instead, the mixer runs
+ * when \ref renderOffline() or \ref renderToFile() is called, and the device clock (see
+ * \ref deviceFrame()) advances by the amount of audio that was rendered. Rendering runs as fast as
+ * the machine allows and the output doesn't depend on timing, so it can be used for benchmarks and
+ * for comparing the output of decoders and resamplers against known good files.
+ *
+ * There is no device to keep up with, so streams don't decode ahead even if
+ * Stream::setDecodeAhead() was used. They decode while rendering instead.
+ *
+ * SDL_InitSubSystem() will not be called and the SDL audio subsystem is left uninitialized.
+ *
+ * \param freq
+ *  Output sample rate.
+ *
+ * \param format
+ *  Output sample format. Unlike with \ref init(), this is never changed.
+ *
+ * \param channels
+ *  Amount of output channels. Can either be 1 (mono) or 2 (stereo.) Other values will be adjusted.
+ *
+ * \param frameSize
+ *  How many frames \ref renderToFile() renders at a time. Streams see the same amount of audio
+ *  requested from them as they would with a device using this frame size.
+ *
+ * \return
+ *  \retval true The library was initialized successfully.
+ *  \retval false The library could not be initialized.
+ */
+AULIB_EXPORT auto initOffline(int freq, AudioFormat format, int channels, int frameSize) -> bool;
+
+/*!
+ * \brief Mixes the next \p len bytes of output into \p out.
+ *
+ * This does what the audio callback does when there's a device. Only available after
+ * \ref initOffline().
+ *
+ * \return
+ *  \retval true The audio was rendered.
+ *  \retval false The library is not initialized for offline rendering.
+ */
+AULIB_EXPORT auto renderOffline(Uint8 out[], int len) -> bool;
+
+/*!
+ * \brief Renders into a WAV file until no stream is playing anymore.
+ *
+ * Only available after \ref initOffline(). Streams need to be started before calling this.
+ * Supported sample formats are AUDIO_U8, AUDIO_S16LSB, AUDIO_S32LSB and AUDIO_F32LSB.
+ *
+ * \param filename
+ *  The file to write. An existing file is overwritten.
+ *
+ * \param maxLength
+ *  Stop after this much audio, even if streams are still playing. This is needed for streams
+ *  that loop forever or are paused.
+ *
+ * \return
+ *  The amount of frames that were written, or -1 on error.
+ */
+AULIB_EXPORT auto renderToFile(const std::string& filename, std::chrono::microseconds maxLength)
+    -> Sint64;
+
 /*!
  *  \brief Shuts down the SDL_audiolib library.
  *
@@ -118,6 +184,95 @@ AULIB_EXPORT auto channelCount() noexcept -> int;
  */
 AULIB_EXPORT auto frameSize() noexcept -> int;
 
+/*!
+ * \brief Changes the frame size of the audio device.
+ *
+ * The device is reopened with the same sample rate, format and channel count. Streams keep
+ * playing, though there will be a short gap in the output. Requires SDL 2.
+ *
+ * If the device can't be reopened with the new frame size, the old one is restored.
+ *
+ * \return
+ *  \retval true The device now uses the requested frame size.
+ *  \retval false The frame size could not be changed. Use \ref frameSize() to find out the frame
+ *  size that is actually used.
+ */
+AULIB_EXPORT auto setFrameSize(int frameSize) -> bool;
+
+/*!
+ * \brief Number of times the mixer failed to deliver audio to the device in time.
+ *
+ * This counts audio callbacks that took longer to mix than the audio they produced lasts, as well
+ * as callbacks that arrived so late that the device must have run out of audio. A rising count
+ * means the frame size is too small for the machine. Underruns of decode-ahead streams are not
+ * included here; see Stream::underrunCount() for those.
+ */
+AULIB_EXPORT auto underrunCount() noexcept -> int;
+
+/*!
+ * \brief The device's sample clock.
+ *
+ * Returns how many frames have been mixed since the audio device was opened. The count only goes
+ * up, by one period each time the device asks for more audio. The next period starts at the
+ * returned frame. Use it with Stream::playAt() to start streams at exact sample positions.
+ */
+AULIB_EXPORT auto deviceFrame() noexcept -> Uint64;
+
+/*!
+ * \brief Performance counters of the mixer.
+ *
+ * See \ref takeMixerStats().
+ */
+struct MixerStats final
+{
+    //! How many times the audio callback ran.
+    int callbacks = 0;
+
+    //! How long the audio of one callback lasts. The callback needs to finish faster than this.
+    std::chrono::microseconds deadline{};
+
+    //! Average and longest time the audio callback took to mix.
+    std::chrono::microseconds averageCallbackTime{};
+    std::chrono::microseconds maxCallbackTime{};
+
+    /*!
+     * How long callbacks took relative to the deadline. The buckets count callbacks that took
+     * less than 1/16, 1/8, 1/4, 1/2, 3/4 and all of the deadline. The last bucket counts callbacks
+     * that missed it.
+     */
+    std::array<int, 7> callbackHistogram{};
+
+    //! See \ref underrunCount().
+    int underruns = 0;
+
+    /*!
+     * Longest time other threads kept the mixer locked, for example while starting or stopping a
+     * stream. The audio callback can't run during that time.
+     */
+    std::chrono::microseconds maxLockTime{};
+};
+
+/*!
+ * \brief Enables or disables collecting performance counters.
+ *
+ * This is disabled by default. When enabled, the audio callback measures how long it takes to mix
+ * and how much of that each stream needs, at the cost of a few clock reads per stream. See
+ * \ref takeMixerStats() and Stream::takeStats().
+ */
+AULIB_EXPORT void setStatsEnabled(bool enabled) noexcept;
+
+//! Whether performance counters are collected.
+AULIB_EXPORT auto statsEnabled() noexcept -> bool;
+
+/*!
+ * \brief Returns the mixer's performance counters and resets them.
+ *
+ * The counters cover the time since the previous call, or since collecting them was enabled with
+ * \ref setStatsEnabled(). Reading them doesn't lock the mixer, so this can be called at any time
+ * from any thread, though there should only be one thread calling it.
+ */
+AULIB_EXPORT auto takeMixerStats() -> MixerStats;
+
 } // namespace Aulib
 
 /*
@@ -19,9 +19,13 @@
 #include "Buffer.h"
 #include "aulib.h"
 #include "aulib_config.h"
+#include "sampleconv.h"
 #include <SDL_audio.h>
 #include <SDL_rwops.h>
 #include <array>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 namespace Aulib {
 
@@ -39,136 +43,243 @@ Aulib::Decoder::Decoder()
 
 Aulib::Decoder::~Decoder() = default;
 
-auto Aulib::Decoder::decoderFor(const std::string& filename) -> std::unique_ptr<Aulib::Decoder>
+namespace {
+
+// Large enough to cover the furthest signature we look at (the MOD tag at offset 1080) as well as
+// the first Ogg page, which carries the codec identification header.
+constexpr size_t PROBE_HEADER_SIZE = 4096;
+
+struct ProbeHeader final
 {
-    auto rwopsClose = [](SDL_RWops* rwops) { SDL_RWclose(rwops); };
-    std::unique_ptr<SDL_RWops, decltype(rwopsClose)> rwops(SDL_RWFromFile(filename.c_str(), "rb"),
-                                                           rwopsClose);
-    return Decoder::decoderFor(rwops.get());
+    std::array<char, PROBE_HEADER_SIZE> buf{};
+    std::string_view data;
+
+    auto hasAt(size_t offset, std::string_view magic) const -> bool
+    {
+        return offset <= data.size() and data.substr(offset, magic.size()) == magic;
+    }
+
+    auto contains(std::string_view magic) const -> bool
+    {
+        return data.find(magic) != std::string_view::npos;
+    }
+};
+
+[[maybe_unused]] auto isFlac(const ProbeHeader& head) -> bool
+{
+    // FLAC files are sometimes prefixed with an ID3v2 tag.
+    return head.hasAt(0, "fLaC") or (head.hasAt(0, "ID3") and head.contains("fLaC"));
 }
 
-auto Aulib::Decoder::decoderFor(SDL_RWops* rwops) -> std::unique_ptr<Aulib::Decoder>
+[[maybe_unused]] auto isOggVorbis(const ProbeHeader& head) -> bool
 {
-    const auto rwPos = SDL_RWtell(rwops);
+    return head.hasAt(0, "OggS") and head.contains("\x01vorbis");
+}
 
-    auto rewindRwops = [rwops, rwPos] { SDL_RWseek(rwops, rwPos, RW_SEEK_SET); };
+[[maybe_unused]] auto isOggOpus(const ProbeHeader& head) -> bool
+{
+    return head.hasAt(0, "OggS") and head.contains("OpusHead");
+}
 
-    [[maybe_unused]] auto tryDecoder = [rwops, &rewindRwops](auto dec) {
-        rewindRwops();
-        bool ret = dec->open(rwops);
-        rewindRwops();
-        return ret;
-    };
+[[maybe_unused]] auto isMusepack(const ProbeHeader& head) -> bool
+{
+    return head.hasAt(0, "MPCK") or head.hasAt(0, "MP+");
+}
 
-#if USE_DEC_DRFLAC
-    if (tryDecoder(std::make_unique<DecoderDrflac>())) {
-        return std::make_unique<Aulib::DecoderDrflac>();
+[[maybe_unused]] auto isMidi(const ProbeHeader& head) -> bool
+{
+    return head.hasAt(0, "MThd");
+}
+
+[[maybe_unused]] auto isWave(const ProbeHeader& head) -> bool
+{
+    return (head.hasAt(0, "RIFF") and head.hasAt(8, "WAVE")) or head.hasAt(0, "RF64")
+           or head.hasAt(0, "riff");
+}
+
+[[maybe_unused]] auto isSndfileAudio(const ProbeHeader& head) -> bool
+{
+    const bool isAiff = head.hasAt(0, "FORM") and (head.hasAt(8, "AIFF") or head.hasAt(8, "AIFC"));
+    return isWave(head) or isAiff or head.hasAt(0, ".snd") or head.hasAt(0, "caff") or isFlac(head)
+           or isOggVorbis(head);
+}
+
+[[maybe_unused]] auto isModule(const ProbeHeader& head) -> bool
+{
+    if (head.hasAt(0, "Extended Module:") or head.hasAt(44, "SCRM") or head.hasAt(0, "IMPM")
+        or head.hasAt(0, "MTM") or head.hasAt(0, "MMD"))
+    {
+        return true;
+    }
+    // ProTracker and compatible MOD files store a format tag at offset 1080.
+    if (head.data.size() < 1084) {
+        return false;
+    }
+    const auto tag = head.data.substr(1080, 4);
+    constexpr std::array<std::string_view, 8> modTags{"M.K.", "M!K!", "M&K!", "FLT4",
+                                                      "FLT8", "CD81", "OKTA", "OCTA"};
+    for (auto modTag : modTags) {
+        if (tag == modTag) {
+            return true;
+        }
+    }
+    auto isDigit = [](char c) { return c >= '0' and c <= '9'; };
+    return (isDigit(tag[0]) and tag.substr(1) == "CHN")
+           or (isDigit(tag[0]) and isDigit(tag[1]) and tag.substr(2) == "CH");
+}
+
+[[maybe_unused]] auto isMpegAudio(const ProbeHeader& head) -> bool
+{
+    if (head.hasAt(0, "ID3")) {
+        return true;
     }
+    // MPEG audio frame sync: 11 set bits.
+    return head.data.size() >= 2 and static_cast<unsigned char>(head.data[0]) == 0xFF
+           and (static_cast<unsigned char>(head.data[1]) & 0xE0) == 0xE0;
+}
+
+struct DecoderEntry final
+{
+    auto (*create)() -> std::unique_ptr<Aulib::Decoder>;
+    auto (*matches)(const ProbeHeader& head) -> bool;
+    // Whether to still try the decoder as a fallback when its signature wasn't found.
+    bool tryWithoutMatch;
+};
+
+template <class T>
+auto makeDecoder() -> std::unique_ptr<Aulib::Decoder>
+{
+    return std::make_unique<T>();
+}
+
+// All known decoders, in the order they are tried within each rank.
+auto decoderRegistry() -> const std::vector<DecoderEntry>&
+{
+    static const std::vector<DecoderEntry> registry{
+#if USE_DEC_DRFLAC
+        {makeDecoder<Aulib::DecoderDrflac>, isFlac, true},
 #endif
 #if USE_DEC_LIBVORBIS
-    if (tryDecoder(std::make_unique<DecoderVorbis>())) {
-        return std::make_unique<Aulib::DecoderVorbis>();
-    }
+        {makeDecoder<Aulib::DecoderVorbis>, isOggVorbis, true},
 #endif
 #if USE_DEC_LIBOPUSFILE
-    if (tryDecoder(std::make_unique<DecoderOpus>())) {
-        return std::make_unique<Aulib::DecoderOpus>();
-    }
+        {makeDecoder<Aulib::DecoderOpus>, isOggOpus, true},
 #endif
 #if USE_DEC_MUSEPACK
-    if (tryDecoder(std::make_unique<DecoderMusepack>())) {
-        return std::make_unique<Aulib::DecoderMusepack>();
-    }
+        {makeDecoder<Aulib::DecoderMusepack>, isMusepack, true},
 #endif
-#if USE_DEC_FLUIDSYNTH or USE_DEC_BASSMIDI or USE_DEC_WILDMIDI or USE_DEC_ADLMIDI
-    {
-        std::array<char, 5> head{};
-        if (SDL_RWread(rwops, head.data(), 1, 4) == 4 and head == decltype(head){"MThd"}) {
-            using midi_dec_type =
-#    if USE_DEC_FLUIDSYNTH
-                DecoderFluidsynth;
-#    elif USE_DEC_BASSMIDI
-                DecoderBassmidi;
-#    elif USE_DEC_WILDMIDI
-                DecoderWildmidi;
-#    elif USE_DEC_ADLMIDI
-                DecoderAdlmidi;
-#    endif
-            if (tryDecoder(std::make_unique<midi_dec_type>())) {
-                return std::make_unique<midi_dec_type>();
-            }
-        }
-    }
+#if USE_DEC_FLUIDSYNTH
+        {makeDecoder<Aulib::DecoderFluidsynth>, isMidi, false},
+#elif USE_DEC_BASSMIDI
+        {makeDecoder<Aulib::DecoderBassmidi>, isMidi, false},
+#elif USE_DEC_WILDMIDI
+        {makeDecoder<Aulib::DecoderWildmidi>, isMidi, false},
+#elif USE_DEC_ADLMIDI
+        {makeDecoder<Aulib::DecoderAdlmidi>, isMidi, false},
 #endif
 #if USE_DEC_SNDFILE
-    if (tryDecoder(std::make_unique<DecoderSndfile>())) {
-        return std::make_unique<Aulib::DecoderSndfile>();
-    }
+        {makeDecoder<Aulib::DecoderSndfile>, isSndfileAudio, true},
 #endif
 #if USE_DEC_DRWAV
-    if (tryDecoder(std::make_unique<DecoderDrwav>())) {
-        return std::make_unique<Aulib::DecoderDrwav>();
-    }
+        {makeDecoder<Aulib::DecoderDrwav>, isWave, true},
 #endif
 #if USE_DEC_OPENMPT
-    if (tryDecoder(std::make_unique<DecoderOpenmpt>())) {
-        return std::make_unique<Aulib::DecoderOpenmpt>();
-    }
+        {makeDecoder<Aulib::DecoderOpenmpt>, isModule, true},
 #endif
-
 #if USE_DEC_XMP
-    if (tryDecoder(std::make_unique<DecoderXmp>())) {
-        return std::make_unique<Aulib::DecoderXmp>();
-    }
+        {makeDecoder<Aulib::DecoderXmp>, isModule, true},
 #endif
 #if USE_DEC_MODPLUG
-    // We don't try ModPlug, since it thinks just about anything is a module
-    // file, which would result in virtually everything we feed it giving a
-    // false positive.
+        // ModPlug thinks just about anything is a module file, so only try it when the header
+        // actually carries a module signature.
+        {makeDecoder<Aulib::DecoderModplug>, isModule, false},
 #endif
-
 // The MP3 decoders have too many false positives. So try them last.
 #if USE_DEC_MPG123
-    if (tryDecoder(std::make_unique<DecoderMpg123>())) {
-        return std::make_unique<Aulib::DecoderMpg123>();
-    }
+        {makeDecoder<Aulib::DecoderMpg123>, isMpegAudio, true},
 #endif
 #if USE_DEC_DRMP3
-    if (tryDecoder(std::make_unique<DecoderDrmp3>())) {
-        return std::make_unique<Aulib::DecoderDrmp3>();
-    }
+        {makeDecoder<Aulib::DecoderDrmp3>, isMpegAudio, true},
 #endif
-    return nullptr;
+    };
+    return registry;
 }
 
-auto Aulib::Decoder::isOpen() const -> bool
+/* Reads the stream header once and tries the decoders whose signature matches it first, then the
+ * remaining ones as a fallback. Returns the decoder that succeeded, already opened, along with its
+ * registry entry. On failure, the rwops is rewound to where it was.
+ */
+auto probeDecoder(SDL_RWops* rwops)
+    -> std::pair<std::unique_ptr<Aulib::Decoder>, const DecoderEntry*>
 {
-    return d->isOpen;
-}
+    const auto rwPos = SDL_RWtell(rwops);
 
-// Conversion happens in-place.
-static constexpr void monoToStereo(float buf[], int len)
-{
-    if (len < 1 or not buf) {
-        return;
+    ProbeHeader head;
+    const auto headLen = SDL_RWread(rwops, head.buf.data(), 1, head.buf.size());
+    head.data = std::string_view(head.buf.data(), headLen);
+
+    std::vector<const DecoderEntry*> candidates;
+    std::vector<const DecoderEntry*> fallbacks;
+    for (const auto& entry : decoderRegistry()) {
+        if (entry.matches(head)) {
+            candidates.push_back(&entry);
+        } else if (entry.tryWithoutMatch) {
+            fallbacks.push_back(&entry);
+        }
     }
-    for (int i = len / 2 - 1, j = len - 1; i >= 0; --i) {
-        buf[j--] = buf[i];
-        buf[j--] = buf[i];
+    candidates.insert(candidates.end(), fallbacks.begin(), fallbacks.end());
+
+    for (const auto* entry : candidates) {
+        SDL_RWseek(rwops, rwPos, RW_SEEK_SET);
+        auto dec = entry->create();
+        if (dec->open(rwops)) {
+            return {std::move(dec), entry};
+        }
     }
+    SDL_RWseek(rwops, rwPos, RW_SEEK_SET);
+    return {nullptr, nullptr};
 }
 
-static constexpr void stereoToMono(float dst[], const float src[], int srcLen)
+} // namespace
+
+auto Aulib::Decoder::decoderFor(const std::string& filename) -> std::unique_ptr<Aulib::Decoder>
 {
-    if (srcLen < 1 or not dst or not src) {
-        return;
+    auto rwopsClose = [](SDL_RWops* rwops) { SDL_RWclose(rwops); };
+    std::unique_ptr<SDL_RWops, decltype(rwopsClose)> rwops(SDL_RWFromFile(filename.c_str(), "rb"),
+                                                           rwopsClose);
+    if (not rwops) {
+        return nullptr;
     }
-    for (int i = 0, j = 0; i < srcLen; i += 2, ++j) {
-        dst[j] = src[i] * 0.5f;
-        dst[j] += src[i + 1] * 0.5f;
+    // The probed decoder reads from our own rwops, which is about to be closed. Hand out an
+    // unopened instance of the same type instead; the stream will open the file itself.
+    auto [dec, entry] = probeDecoder(rwops.get());
+    if (not dec) {
+        return nullptr;
     }
+    return entry->create();
+}
+
+auto Aulib::Decoder::decoderFor(SDL_RWops* rwops) -> std::unique_ptr<Aulib::Decoder>
+{
+    return probeDecoder(rwops).first;
 }
 
+auto Aulib::Decoder::isOpen() const -> bool
+{
+    return d->isOpen;
+}
+
+auto Aulib::Decoder::reduceLoad() -> bool
+{
+    return false;
+}
+
+auto Aulib::Decoder::restoreLoad() -> bool
+{
+    return false;
+}
+
+// Conversion happens in-place.
 auto Aulib::Decoder::decode(float buf[], int len, bool& callAgain) -> int
 {
     if (this->getChannels() == 1 and Aulib::channelCount() == 2) {
@@ -7,6 +7,7 @@
 #include "missing.h"
 #include <SDL_rwops.h>
 #include <adlmidi.h>
+#include <algorithm>
 
 namespace chrono = std::chrono;
 using BankData = std::unique_ptr<void, decltype(&SDL_free)>;
@@ -40,6 +41,9 @@ struct DecoderAdlmidi_priv final
     DecoderAdlmidi::Emulator emulator;
     bool change_emulator = false;
     int chip_amount = 6;
+    // Chips we're actually emulating. Lower than chip_amount while the load governor has reduced
+    // it.
+    int active_chips = 0;
     BankData bank_data{nullptr, SDL_free};
     size_t bank_data_size = 0;
     int embedded_bank = -1;
@@ -79,11 +83,17 @@ struct DecoderAdlmidi_priv final
 
     auto setChipAmount() -> bool
     {
-        if (adl_setNumChips(adl_player.get(), chip_amount) < 0) {
+        return setActiveChips(chip_amount);
+    }
+
+    auto setActiveChips(int chips) -> bool
+    {
+        if (adl_setNumChips(adl_player.get(), chips) < 0) {
             SDL_SetError("libADLMIDI failed to change chip amount. %s",
                          adl_errorInfo(adl_player.get()));
             return false;
         }
+        active_chips = chips;
         return true;
     }
 
@@ -144,6 +154,25 @@ auto Aulib::DecoderAdlmidi::setChipAmount(int chip_amount) -> bool
     return true;
 }
 
+// Every chip adds voices and costs about the same to emulate, so halving the chips roughly halves
+// the load. libADLMIDI stops the playing notes when the chip amount changes, but keeps the channel
+// setup, so the music continues with the next notes.
+auto Aulib::DecoderAdlmidi::reduceLoad() -> bool
+{
+    if (not isOpen() or d->active_chips <= 1) {
+        return false;
+    }
+    return d->setActiveChips(std::max(1, d->active_chips / 2));
+}
+
+auto Aulib::DecoderAdlmidi::restoreLoad() -> bool
+{
+    if (not isOpen() or d->active_chips >= d->chip_amount) {
+        return false;
+    }
+    return d->setActiveChips(std::min(d->chip_amount, d->active_chips * 2));
+}
+
 auto Aulib::DecoderAdlmidi::loadBank(SDL_RWops* rwops) -> bool
 {
     if (not rwops) {
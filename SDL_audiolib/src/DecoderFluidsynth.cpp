@@ -7,9 +7,13 @@
 #include "missing.h"
 #include <SDL_audio.h>
 #include <SDL_rwops.h>
+#include <algorithm>
 #include <array>
 #include <cstdio>
 #include <fluidsynth.h>
+#include <mutex>
+#include <string>
+#include <vector>
 
 #if FLUIDSYNTH_VERSION_MAJOR == 2 && FLUIDSYNTH_VERSION_MINOR >= 2
 using read_cb_count_type = fluid_long_long_t;
@@ -104,19 +108,78 @@ static auto initFluidSynth() -> int
     return 0;
 }
 
+using SynthPtr = std::unique_ptr<fluid_synth_t, decltype(&delete_fluid_synth)>;
+
+/* Loading a soundfont can take a long time. When a decoder is destroyed, we keep its synth around
+ * with the soundfont still loaded, so that the next decoder that wants the same soundfont can take
+ * it over instead of loading it again.
+ */
+namespace {
+struct WarmSynth final
+{
+    std::string soundfont;
+    SynthPtr synth;
+};
+
+std::mutex warmSynthsMutex;
+std::vector<WarmSynth> warmSynths;
+constexpr size_t maxWarmSynths = 2;
+} // namespace
+
+static auto takeWarmSynth(const std::string& soundfont) -> SynthPtr
+{
+    std::lock_guard<std::mutex> lock(warmSynthsMutex);
+    auto it = std::find_if(warmSynths.begin(), warmSynths.end(),
+                           [&soundfont](const WarmSynth& s) { return s.soundfont == soundfont; });
+    if (it == warmSynths.end()) {
+        return {nullptr, &delete_fluid_synth};
+    }
+    auto synth = std::move(it->synth);
+    warmSynths.erase(it);
+    return synth;
+}
+
+// FluidSynth's own default.
+constexpr float defaultGain = 0.2f;
+
+static void keepWarmSynth(std::string soundfont, SynthPtr synth)
+{
+    // Silence everything and reset all MIDI state, but keep the soundfont. Also restore the
+    // default gain, since the next user might not set one.
+    fluid_synth_system_reset(synth.get());
+    fluid_synth_set_gain(synth.get(), defaultGain);
+
+    std::lock_guard<std::mutex> lock(warmSynthsMutex);
+    if (warmSynths.size() >= maxWarmSynths) {
+        warmSynths.erase(warmSynths.begin());
+    }
+    warmSynths.push_back({std::move(soundfont), std::move(synth)});
+}
+
 namespace Aulib {
 
 struct DecoderFluidsynth_priv final
 {
     DecoderFluidsynth_priv();
+    ~DecoderFluidsynth_priv();
 
-    std::unique_ptr<fluid_synth_t, decltype(&delete_fluid_synth)> fSynth{nullptr,
-                                                                         &delete_fluid_synth};
+    SynthPtr fSynth{nullptr, &delete_fluid_synth};
     std::unique_ptr<fluid_player_t, decltype(&delete_fluid_player)> fPlayer{nullptr,
                                                                             &delete_fluid_player};
     fluid_sfloader_t* sfloader = nullptr;
     Buffer<Uint8> fMidiData{0};
     bool fEOF = false;
+    // How many soundfonts are loaded into fSynth. If it's exactly one and we know what it is,
+    // fSoundfont holds its name so the synth can be reused by other decoders.
+    int fSoundfontCount = 0;
+    std::string fSoundfont;
+    // Polyphony before the load governor reduced it, or 0 if it's not reduced.
+    int fFullPolyphony = 0;
+    // Kept here, so that it can be set before we know which synth we'll be using.
+    float fGain = defaultGain;
+
+    auto fEnsureSynth() -> bool;
+    auto fAdoptWarmSynth(const std::string& soundfont) -> bool;
 };
 
 } // namespace Aulib
@@ -126,9 +189,28 @@ Aulib::DecoderFluidsynth_priv::DecoderFluidsynth_priv()
     if (not settings) {
         initFluidSynth();
     }
+}
+
+Aulib::DecoderFluidsynth_priv::~DecoderFluidsynth_priv()
+{
+    fPlayer.reset();
+    if (fSynth and fFullPolyphony > 0) {
+        fluid_synth_set_polyphony(fSynth.get(), fFullPolyphony);
+    }
+    if (fSynth and fSoundfontCount == 1 and not fSoundfont.empty()) {
+        keepWarmSynth(std::move(fSoundfont), std::move(fSynth));
+    }
+}
+
+// The synth is only created when first needed, since we might get a warm one instead.
+auto Aulib::DecoderFluidsynth_priv::fEnsureSynth() -> bool
+{
+    if (fSynth) {
+        return true;
+    }
     fSynth.reset(new_fluid_synth(settings));
     if (not fSynth) {
-        return;
+        return false;
     }
     fluid_synth_set_interp_method(fSynth.get(), -1, FLUID_INTERP_7THORDER);
     fluid_synth_set_reverb(fSynth.get(),
@@ -136,10 +218,29 @@ Aulib::DecoderFluidsynth_priv::DecoderFluidsynth_priv()
                            0.5, // Damping
                            0.5, // Width
                            0.3); // Level
+    fluid_synth_set_gain(fSynth.get(), fGain);
     sfloader = new_fluid_defsfloader(settings);
     fluid_sfloader_set_callbacks(sfloader, sfontOpenCb, sfontReadCb, sfontSeekCb, sfontTellCb,
                                  sfontCloseCb);
     fluid_synth_add_sfloader(fSynth.get(), sfloader);
+    return true;
+}
+
+auto Aulib::DecoderFluidsynth_priv::fAdoptWarmSynth(const std::string& soundfont) -> bool
+{
+    // Only possible if we haven't created a synth ourselves yet.
+    if (soundfont.empty() or fSynth) {
+        return false;
+    }
+    auto synth = takeWarmSynth(soundfont);
+    if (not synth) {
+        return false;
+    }
+    fSynth = std::move(synth);
+    fluid_synth_set_gain(fSynth.get(), fGain);
+    fSoundfontCount = 1;
+    fSoundfont = soundfont;
+    return true;
 }
 
 Aulib::DecoderFluidsynth::DecoderFluidsynth()
@@ -150,7 +251,7 @@ Aulib::DecoderFluidsynth::~DecoderFluidsynth() = default;
 
 auto Aulib::DecoderFluidsynth::loadSoundfont(SDL_RWops* rwops) -> bool
 {
-    if (not d->fSynth) {
+    if (not d->fEnsureSynth()) {
         return false;
     }
     if (not rwops) {
@@ -176,35 +277,56 @@ auto Aulib::DecoderFluidsynth::loadSoundfont(SDL_RWops* rwops) -> bool
         closeRwops();
         return false;
     }
+    ++d->fSoundfontCount;
+    d->fSoundfont.clear();
+    return true;
+}
+
+auto Aulib::DecoderFluidsynth::loadSoundfont(SDL_RWops* rwops, const std::string& cacheKey) -> bool
+{
+    if (d->fAdoptWarmSynth(cacheKey)) {
+        if (rwops and SDL_RWclose(rwops) != 0) {
+            aulib::log::warnLn("failed to close rwops: {}", SDL_GetError());
+        }
+        return true;
+    }
+    if (not loadSoundfont(rwops)) {
+        return false;
+    }
+    if (d->fSoundfontCount == 1) {
+        d->fSoundfont = cacheKey;
+    }
     return true;
 }
 
 auto Aulib::DecoderFluidsynth::loadSoundfont(const std::string& filename) -> bool
 {
-    if (not d->fSynth) {
+    if (d->fAdoptWarmSynth(filename)) {
+        return true;
+    }
+    if (not d->fEnsureSynth()) {
         return false;
     }
     if (fluid_synth_sfload(d->fSynth.get(), filename.c_str(), 1) == FLUID_FAILED) {
         SDL_SetError("FluidSynth failed to load soundfont.");
         return false;
     }
+    ++d->fSoundfontCount;
+    d->fSoundfont = d->fSoundfontCount == 1 ? filename : std::string();
     return true;
 }
 
 auto Aulib::DecoderFluidsynth::gain() const -> float
 {
-    if (not d->fSynth) {
-        return 0.f;
-    }
-    return fluid_synth_get_gain(d->fSynth.get());
+    return d->fGain;
 }
 
 void Aulib::DecoderFluidsynth::setGain(float gain)
 {
-    if (not d->fSynth) {
-        return;
+    d->fGain = gain;
+    if (d->fSynth) {
+        fluid_synth_set_gain(d->fSynth.get(), gain);
     }
-    fluid_synth_set_gain(d->fSynth.get(), gain);
 }
 
 auto Aulib::DecoderFluidsynth::open(SDL_RWops* rwops) -> bool
@@ -212,7 +334,7 @@ auto Aulib::DecoderFluidsynth::open(SDL_RWops* rwops) -> bool
     if (isOpen()) {
         return true;
     }
-    if (not d->fSynth) {
+    if (not d->fEnsureSynth()) {
         SDL_SetError("FluidSynth failed to initialize.");
         return false;
     }
@@ -308,6 +430,43 @@ auto Aulib::DecoderFluidsynth::rewind() -> bool
     return true;
 }
 
+// Below this, even simple pieces start losing notes.
+constexpr int minPolyphony = 16;
+
+// Fluidsynth's cost scales with the number of playing voices. Lowering the polyphony stops the
+// voices above the new limit, and after that new notes steal the least important voices.
+auto Aulib::DecoderFluidsynth::reduceLoad() -> bool
+{
+    if (not isOpen()) {
+        return false;
+    }
+    const int polyphony = fluid_synth_get_polyphony(d->fSynth.get());
+    if (polyphony <= minPolyphony) {
+        return false;
+    }
+    if (d->fFullPolyphony == 0) {
+        d->fFullPolyphony = polyphony;
+    }
+    return fluid_synth_set_polyphony(d->fSynth.get(), std::max(minPolyphony, polyphony / 2))
+           == FLUID_OK;
+}
+
+auto Aulib::DecoderFluidsynth::restoreLoad() -> bool
+{
+    if (not isOpen() or d->fFullPolyphony == 0) {
+        return false;
+    }
+    const int polyphony =
+        std::min(d->fFullPolyphony, fluid_synth_get_polyphony(d->fSynth.get()) * 2);
+    if (fluid_synth_set_polyphony(d->fSynth.get(), polyphony) != FLUID_OK) {
+        return false;
+    }
+    if (polyphony == d->fFullPolyphony) {
+        d->fFullPolyphony = 0;
+    }
+    return true;
+}
+
 auto Aulib::DecoderFluidsynth::duration() const -> chrono::microseconds
 {
     SDL_SetError("Duration cannot be determined with this decoder.");
@@ -0,0 +1,415 @@
+// This is copyrighted software. More information is at the end of this file.
+#include "LoopDecoder.h"
+
+#include "aulib.h"
+#include <SDL_timer.h>
+#include <algorithm>
+
+// How much of the start of a loop to keep in memory. This is how long the background seek has
+// before the reading thread would have to wait for it.
+constexpr int loopHeadMs = 1000;
+
+Aulib::LoopDecoder::LoopDecoder(std::unique_ptr<Decoder> source)
+    : fSource(std::move(source))
+{}
+
+Aulib::LoopDecoder::~LoopDecoder()
+{
+    if (not fSeekThread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(fSeekMutex);
+        fSeekQuit = true;
+    }
+    fSeekCond.notify_all();
+    fSeekThread.join();
+}
+
+void Aulib::LoopDecoder::setLoop(const int repeats, const Sint64 startFrame, const Sint64 endFrame)
+{
+    fWaitForSeek();
+    fRepeats = repeats;
+
+    const Sint64 start = std::max<Sint64>(0, startFrame);
+    const Sint64 end = endFrame > start ? endFrame : -1;
+    if (start != fLoopStart or end != fLoopEnd) {
+        fLoopStart = start;
+        fLoopEnd = end;
+        fResetHead();
+    }
+    if (repeats == 0 or not isOpen()) {
+        return;
+    }
+
+    const int headLen = getRate() * loopHeadMs / 1000 * getChannels();
+    if (fHead.size() != headLen) {
+        fHead.reset(headLen);
+        fResetHead();
+    }
+    if (not fSeekThread.joinable()) {
+        fSeekThread = std::thread(&LoopDecoder::fSeekLoop, this);
+    }
+}
+
+auto Aulib::LoopDecoder::takeLoopCount() -> int
+{
+    return fLoopCount.exchange(0);
+}
+
+void Aulib::LoopDecoder::setTimed(const bool timed)
+{
+    fTimed = timed;
+    if (not timed) {
+        fDecodeTicks = 0;
+    }
+}
+
+auto Aulib::LoopDecoder::takeDecodeTicks() -> Uint64
+{
+    const Uint64 ticks = fDecodeTicks;
+    fDecodeTicks = 0;
+    return ticks;
+}
+
+void Aulib::LoopDecoder::setMayWait(const bool mayWait)
+{
+    fMayWait = mayWait;
+}
+
+auto Aulib::LoopDecoder::takeUnderruns() -> int
+{
+    return fUnderruns.exchange(0);
+}
+
+auto Aulib::LoopDecoder::takeWaitTicks() -> Uint64
+{
+    const Uint64 ticks = fWaitTicks;
+    fWaitTicks = 0;
+    return ticks;
+}
+
+auto Aulib::LoopDecoder::open(SDL_RWops* rwops) -> bool
+{
+    if (isOpen()) {
+        return true;
+    }
+    if (not fSource->open(rwops)) {
+        return false;
+    }
+    setIsOpen(true);
+    return true;
+}
+
+auto Aulib::LoopDecoder::getChannels() const -> int
+{
+    // We get our samples from the source's decode(), which already converted between mono and
+    // stereo if needed.
+    const int srcChannels = fSource->getChannels();
+    const int dstChannels = Aulib::channelCount();
+    if ((srcChannels == 1 and dstChannels == 2) or (srcChannels == 2 and dstChannels == 1)) {
+        return dstChannels;
+    }
+    return srcChannels;
+}
+
+auto Aulib::LoopDecoder::getRate() const -> int
+{
+    return fSource->getRate();
+}
+
+auto Aulib::LoopDecoder::rewind() -> bool
+{
+    // Streams rewind when they stop. The source might get different audio before the next play
+    // (like a reused voice getting a new sample), so the head we kept can't be trusted anymore.
+    fResetHead();
+    fPassFrames = 0;
+    if (fSeekThread.joinable()) {
+        // Stopping can happen in the audio callback, so we don't wait for a seek that's still
+        // running, and don't rewind here either. The seek thread does it after that seek.
+        fRequestSeek(0);
+        fPos = 0;
+        fPosKnown = true;
+        return true;
+    }
+    if (not fSource->rewind()) {
+        fPosKnown = false;
+        return false;
+    }
+    fPos = 0;
+    fPosKnown = true;
+    return true;
+}
+
+auto Aulib::LoopDecoder::duration() const -> std::chrono::microseconds
+{
+    // A rewind might still be running in the seek thread.
+    fWaitForSeekThread();
+    return fSource->duration();
+}
+
+auto Aulib::LoopDecoder::seekToTime(const std::chrono::microseconds pos) -> bool
+{
+    fWaitForSeek();
+    if (not fSource->seekToTime(pos)) {
+        return false;
+    }
+    fPlayingHead = false;
+    fPassFrames = 0;
+    fPos = pos.count() * getRate() / 1000000;
+    fPosKnown = true;
+    return true;
+}
+
+// These are called between decode calls, so the only one who might be using the source is the
+// seek thread. If it is, we don't wait for it and let the caller try again later.
+auto Aulib::LoopDecoder::reduceLoad() -> bool
+{
+    return fSourceIsIdle() and fSource->reduceLoad();
+}
+
+auto Aulib::LoopDecoder::restoreLoad() -> bool
+{
+    return fSourceIsIdle() and fSource->restoreLoad();
+}
+
+auto Aulib::LoopDecoder::doDecoding(float buf[], const int len, bool& callAgain) -> int
+{
+    const int channels = getChannels();
+    int pos = 0;
+
+    while (pos < len) {
+        // The seek behind the head only matters once the head is done.
+        if (fAwaitingSeek and not fPlayingHead) {
+            if (fMayWait) {
+                const Uint64 start_ticks = SDL_GetPerformanceCounter();
+                fWaitForSeek();
+                fWaitTicks += SDL_GetPerformanceCounter() - start_ticks;
+            } else if (not fSourceIsIdle()) {
+                std::fill(buf + pos, buf + len, 0.f);
+                ++fUnderruns;
+                return len;
+            }
+            fAwaitingSeek = false;
+        }
+        if (fPlayingHead) {
+            const int n = std::min(fHeadLen - fHeadPos, len - pos);
+            std::copy_n(fHead.get() + fHeadPos, n, buf + pos);
+            fHeadPos += n;
+            fPassFrames += n / channels;
+            pos += n;
+            if (fHeadPos < fHeadLen) {
+                break;
+            }
+            fPlayingHead = false;
+            // If the head holds the whole loop, the source was never moved and is still sitting
+            // at the loop end. Otherwise it's being seeked to where the head ends.
+            if (not fHeadIsWholeLoop) {
+                fPos = fLoopStart + fHeadLen / channels;
+            }
+            continue;
+        }
+
+        int wanted = len - pos;
+        if (fRepeats != 0 and fLoopEnd >= 0) {
+            wanted = static_cast<int>(
+                std::min<Sint64>(wanted, std::max<Sint64>(0, fLoopEnd - fPos) * channels));
+        }
+        if (wanted > 0) {
+            const Uint64 start_ticks = fTimed ? SDL_GetPerformanceCounter() : 0;
+            const int got = fSource->decode(buf + pos, wanted, callAgain);
+            if (fTimed) {
+                fDecodeTicks += SDL_GetPerformanceCounter() - start_ticks;
+            }
+            if (callAgain) {
+                // The source changed its spec. Audio we kept from before would no longer match.
+                fResetHead();
+                fPosKnown = false;
+                return pos + got;
+            }
+            fCaptureHead(buf + pos, got);
+            fPos += got / channels;
+            fPassFrames += got / channels;
+            pos += got;
+            if (got == wanted) {
+                continue;
+            }
+        }
+        // We're at the loop end or the end of the audio.
+        if (fRepeats == 0 or not fStartLoop()) {
+            break;
+        }
+    }
+    return pos;
+}
+
+auto Aulib::LoopDecoder::fStartLoop() -> bool
+{
+    // Looping over nothing would never end.
+    if (fPassFrames == 0) {
+        return false;
+    }
+
+    const int channels = getChannels();
+    if (not fHeadComplete and fHeadLen > 0 and fPosKnown
+        and fHeadLen == (fPos - fLoopStart) * channels) {
+        fHeadComplete = true;
+        fHeadIsWholeLoop = true;
+    }
+
+    if (fRepeats > 0) {
+        --fRepeats;
+    }
+    ++fLoopCount;
+    fPassFrames = 0;
+
+    if (fHeadComplete) {
+        fPlayingHead = true;
+        fHeadPos = 0;
+        if (not fHeadIsWholeLoop) {
+            fRequestSeek(fLoopStart + fHeadLen / channels);
+        }
+    } else {
+        // We don't have the head (the start of the loop might have been skipped by seeking), so
+        // there's nothing to play while seeking. The head gets captured on the way this time.
+        fResetHead();
+        fRequestSeek(fLoopStart);
+        fPos = fLoopStart;
+        fPosKnown = true;
+    }
+    return true;
+}
+
+void Aulib::LoopDecoder::fCaptureHead(const float buf[], const int len)
+{
+    if (fHeadComplete or not fPosKnown or fHead.size() == 0) {
+        return;
+    }
+
+    const int channels = getChannels();
+    const Sint64 first = std::max(fPos, fLoopStart);
+    const Sint64 last = std::min(fPos + len / channels, fLoopStart + fHead.size() / channels);
+    // Only keep audio that continues exactly where the head currently ends.
+    if (first >= last or fHeadLen != (first - fLoopStart) * channels) {
+        return;
+    }
+
+    const auto n = static_cast<int>((last - first) * channels);
+    std::copy_n(buf + (first - fPos) * channels, n, fHead.get() + fHeadLen);
+    fHeadLen += n;
+    fHeadComplete = fHeadLen == fHead.size();
+}
+
+void Aulib::LoopDecoder::fResetHead()
+{
+    fHeadLen = 0;
+    fHeadPos = 0;
+    fHeadComplete = false;
+    fHeadIsWholeLoop = false;
+    fPlayingHead = false;
+}
+
+void Aulib::LoopDecoder::fSeekSource(const Sint64 frame)
+{
+    if (frame == 0) {
+        fSource->rewind();
+        return;
+    }
+
+    // Round up, so that decoders that truncate the time back to frames land on the right one.
+    const Sint64 rate = fSource->getRate();
+    if (fSource->seekToTime(std::chrono::microseconds((frame * 1000000 + rate - 1) / rate))) {
+        return;
+    }
+
+    // The source can't seek. Decode our way there from the start instead.
+    fSource->rewind();
+    Sint64 left = frame * getChannels();
+    while (left > 0) {
+        bool callAgain = false;
+        const int len = static_cast<int>(std::min<Sint64>(left, fScratch.size()));
+        const int got = fSource->decode(fScratch.get(), len, callAgain);
+        if (got <= 0 and not callAgain) {
+            break;
+        }
+        left -= got;
+    }
+}
+
+void Aulib::LoopDecoder::fRequestSeek(const Sint64 frame)
+{
+    if (not fSeekThread.joinable()) {
+        // Only when looping was set up before the source was opened.
+        fSeekSource(frame);
+        return;
+    }
+    fAwaitingSeek = true;
+    {
+        std::lock_guard<std::mutex> lock(fSeekMutex);
+        fSeekTarget = frame;
+        fSeekPending = true;
+    }
+    fSeekCond.notify_all();
+}
+
+void Aulib::LoopDecoder::fWaitForSeek()
+{
+    fWaitForSeekThread();
+    fAwaitingSeek = false;
+}
+
+void Aulib::LoopDecoder::fWaitForSeekThread() const
+{
+    std::unique_lock<std::mutex> lock(fSeekMutex);
+    fSeekCond.wait(lock, [this] { return not fSeekPending and not fSeekBusy; });
+}
+
+// Doesn't wait for the lock either. The seek thread only holds it for a moment, so we just say
+// it's busy and get asked again later.
+auto Aulib::LoopDecoder::fSourceIsIdle() -> bool
+{
+    std::unique_lock<std::mutex> lock(fSeekMutex, std::try_to_lock);
+    return lock.owns_lock() and not fSeekPending and not fSeekBusy;
+}
+
+void Aulib::LoopDecoder::fSeekLoop()
+{
+    std::unique_lock<std::mutex> lock(fSeekMutex);
+    while (true) {
+        fSeekCond.wait(lock, [this] { return fSeekQuit or fSeekPending; });
+        if (fSeekQuit) {
+            return;
+        }
+        // Nobody touches the source while we're busy. A new request can come in meanwhile (a
+        // rewind), and we get to it in the next round.
+        const Sint64 target = fSeekTarget;
+        fSeekPending = false;
+        fSeekBusy = true;
+        lock.unlock();
+        fSeekSource(target);
+        lock.lock();
+        fSeekBusy = false;
+        fSeekCond.notify_all();
+    }
+}
+
+/*
+
+Copyright (C) 2014, 2015, 2016, 2017, 2018, 2019 Nikos Chantziaras.
+
+This file is part of SDL_audiolib.
+
+SDL_audiolib is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the Free
+Software Foundation, either version 3 of the License, or (at your option) any
+later version.
+
+SDL_audiolib is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with SDL_audiolib. If not, see <http://www.gnu.org/licenses/>.
+
+*/
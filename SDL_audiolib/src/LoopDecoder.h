@@ -0,0 +1,140 @@
+// This is copyrighted software. More information is at the end of this file.
+#pragma once
+
+#include "Aulib/Decoder.h"
+#include "Buffer.h"
+#include <SDL_stdinc.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace Aulib {
+
+/* Wraps the decoder of a stream and takes care of looping, so that whoever reads from it (usually
+ * the resampler) gets one continuous run of samples across loop points.
+ *
+ * The start of the loop (the "head") is kept in memory after it has been decoded once. When the
+ * loop end is reached, the head is played from memory while a background thread seeks the real
+ * decoder to where the head ends. Loops short enough to fit in the head never touch the real
+ * decoder again.
+ *
+ * When the head isn't available at the loop end (because the loop start was skipped by seeking, or
+ * after a rewind), the seek back to the loop start is also left to the background thread. Rewinds
+ * go there too when the thread is running. If the reader catches up with a seek that hasn't
+ * finished yet, it gets silence (counted as an underrun) instead of waiting, unless it said it may
+ * wait. The audio callback never may.
+ */
+class LoopDecoder final: public Decoder
+{
+public:
+    explicit LoopDecoder(std::unique_ptr<Decoder> source);
+    ~LoopDecoder() override;
+
+    /* Set how many times to repeat after the first iteration (-1 means forever) and the loop range
+     * in sample frames. A negative end means the end of the audio. Must not be called while
+     * decoding.
+     */
+    void setLoop(int repeats, Sint64 startFrame, Sint64 endFrame);
+
+    // Returns how many times we looped since the last call.
+    auto takeLoopCount() -> int;
+
+    /* While timed, we measure how long the source decoder takes. takeDecodeTicks() returns the
+     * performance counter ticks it took since the last call. Both are meant to be called by the
+     * thread that decodes.
+     */
+    void setTimed(bool timed);
+    auto takeDecodeTicks() -> Uint64;
+
+    /* Whether decoding may wait for a background seek to finish. Otherwise, we output silence
+     * until it does. takeUnderruns() returns how many times that happened since the last call.
+     */
+    void setMayWait(bool mayWait);
+    auto takeUnderruns() -> int;
+
+    // Returns the performance counter ticks spent waiting for background seeks since the last
+    // call. That time is part of decode(), but it isn't decoding work.
+    auto takeWaitTicks() -> Uint64;
+
+    auto open(SDL_RWops* rwops) -> bool override;
+    auto getChannels() const -> int override;
+    auto getRate() const -> int override;
+    auto rewind() -> bool override;
+    auto duration() const -> std::chrono::microseconds override;
+    auto seekToTime(std::chrono::microseconds pos) -> bool override;
+    auto reduceLoad() -> bool override;
+    auto restoreLoad() -> bool override;
+
+protected:
+    auto doDecoding(float buf[], int len, bool& callAgain) -> int override;
+
+private:
+    const std::unique_ptr<Decoder> fSource;
+    int fRepeats = 0;
+    Sint64 fLoopStart = 0;
+    Sint64 fLoopEnd = -1;
+    // Position of the source in frames. Only meaningful if fPosKnown is set.
+    Sint64 fPos = 0;
+    bool fPosKnown = true;
+    // Frames we produced since the last loop point.
+    Sint64 fPassFrames = 0;
+    std::atomic_int fLoopCount{0};
+    std::atomic_int fUnderruns{0};
+    bool fTimed = false;
+    bool fMayWait = false;
+    Uint64 fDecodeTicks = 0;
+    Uint64 fWaitTicks = 0;
+
+    Buffer<float> fHead{0};
+    int fHeadLen = 0;
+    int fHeadPos = 0;
+    bool fHeadComplete = false;
+    bool fHeadIsWholeLoop = false;
+    bool fPlayingHead = false;
+    // We asked the seek thread to move the source and can't decode before it's done.
+    bool fAwaitingSeek = false;
+    Buffer<float> fScratch{4096};
+
+    std::thread fSeekThread;
+    mutable std::mutex fSeekMutex;
+    mutable std::condition_variable fSeekCond;
+    Sint64 fSeekTarget = 0;
+    bool fSeekPending = false;
+    bool fSeekBusy = false;
+    bool fSeekQuit = false;
+
+    auto fStartLoop() -> bool;
+    void fCaptureHead(const float buf[], int len);
+    void fResetHead();
+    void fSeekSource(Sint64 frame);
+    void fRequestSeek(Sint64 frame);
+    void fWaitForSeek();
+    void fWaitForSeekThread() const;
+    auto fSourceIsIdle() -> bool;
+    void fSeekLoop();
+};
+
+} // namespace Aulib
+
+/*
+
+Copyright (C) 2014, 2015, 2016, 2017, 2018, 2019 Nikos Chantziaras.
+
+This file is part of SDL_audiolib.
+
+SDL_audiolib is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the Free
+Software Foundation, either version 3 of the License, or (at your option) any
+later version.
+
+SDL_audiolib is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with SDL_audiolib. If not, see <http://www.gnu.org/licenses/>.
+
+*/
@@ -4,6 +4,16 @@
 Aulib::Processor::Processor() = default;
 Aulib::Processor::~Processor() = default;
 
+auto Aulib::Processor::canProcessInPlace() const -> bool
+{
+    return false;
+}
+
+auto Aulib::Processor::pureGain() const -> std::optional<float>
+{
+    return std::nullopt;
+}
+
 /*
 
 Copyright (C) 2014, 2015, 2016, 2017, 2018, 2019 Nikos Chantziaras.
@@ -7,34 +7,9 @@
 #include "aulib_log.h"
 #include <SDL_audio.h>
 #include <algorithm>
-#include <cmath>
 #include <cstring>
 #include <utility>
 
-/* Relocate any samples in the specified buffer to the beginning:
- *
- *      ....ssss  ->  ssss....
- *
- * The tracking indices are adjusted as needed.
- */
-static void relocateBuffer(float* buf, int& pos, int& end)
-{
-    if (end < 1) {
-        return;
-    }
-    if (pos >= end) {
-        pos = end = 0;
-        return;
-    }
-    if (pos < 1) {
-        return;
-    }
-    int len = end - pos;
-    memmove(buf, buf + pos, static_cast<size_t>(len) * sizeof(*buf));
-    pos = 0;
-    end = len;
-}
-
 namespace Aulib {
 
 struct Resampler_priv final
@@ -48,29 +23,33 @@ struct Resampler_priv final
     int fSrcRate = 0;
     int fChannels = 0;
     int fChunkSize = 0;
-    Buffer<float> fOutBuffer{0};
+    // Decoded samples waiting to be resampled. This is a ring buffer with a power of two amount of
+    // frames, so frame positions wrap around with a simple mask.
     Buffer<float> fInBuffer{0};
-    int fOutBufferPos = 0;
-    int fOutBufferEnd = 0;
-    int fInBufferPos = 0;
-    int fInBufferEnd = 0;
+    int fInFrameMask = 0;
+    int fInReadFrame = 0;
+    int fInFrames = 0;
     bool fPendingSpecChange = false;
 
-    /* Move at most 'dstLen' samples from the output buffer into 'dst'.
-     *
-     * Returns the amount of samples that were actually moved.
+    /* Adjust the input buffer for the current chunk size and amount of channels. Sample rates
+     * don't affect it, so rate changes don't need a new buffer.
      */
-    auto fMoveFromOutBuffer(float dst[], int dstLen) -> int;
+    void fAdjustBufferSizes();
 
-    /* Adjust all internal buffer sizes for the current source and target
-     * sampling rates.
+    /* Decode into the free space of the input buffer, up to where it wraps around. Sets 'eof' if
+     * the decoder has no more samples.
+     *
+     * Returns the amount of frames that were added.
      */
-    void fAdjustBufferSizes();
+    auto fFillInBuffer(bool& eof) -> int;
 
-    /* Resample samples from the input buffer and move them to the output
-     * buffer.
+    /* Resample samples from the input buffer into 'dst'. If the buffered samples wrap around the
+     * end of the buffer, only the part up to the end is used; the rest is left for the next call.
+     *
+     * Returns the amount of samples stored in 'dst'. 'consumed' is set to the amount of input
+     * frames that were used up.
      */
-    void fResampleFromInBuffer();
+    auto fResampleFromInBuffer(float dst[], int dstLen, int& consumed) -> int;
 };
 
 } // namespace Aulib
@@ -79,77 +58,76 @@ Aulib::Resampler_priv::Resampler_priv(Resampler* pub)
     : q(pub)
 {}
 
-auto Aulib::Resampler_priv::fMoveFromOutBuffer(float dst[], int dstLen) -> int
+void Aulib::Resampler_priv::fAdjustBufferSizes()
 {
-    if (fOutBufferEnd == 0) {
-        return 0;
+    int frames = 256;
+    while (frames < fChunkSize) {
+        frames *= 2;
     }
-    if (fOutBufferPos >= fOutBufferEnd) {
-        fOutBufferPos = fOutBufferEnd = 0;
-        return 0;
+    if (frames - 1 == fInFrameMask and fInBuffer.size() == frames * fChannels) {
+        return;
     }
-    int len = std::min(fOutBufferEnd - fOutBufferPos, dstLen);
-    memcpy(dst, fOutBuffer.get() + fOutBufferPos,
-           static_cast<size_t>(len) * sizeof(*fOutBuffer.get()));
-    fOutBufferPos += len;
-    if (fOutBufferPos >= fOutBufferEnd) {
-        fOutBufferEnd = fOutBufferPos = 0;
+
+    // Keep whatever is still buffered, unless it no longer fits or has a different layout.
+    Buffer<float> newBuffer(frames * fChannels);
+    const int oldCapacity = fInFrameMask + 1;
+    int keep = 0;
+    if (fInFrames > 0 and fInBuffer.size() == oldCapacity * fChannels) {
+        keep = std::min(fInFrames, frames);
+        const int firstLen = std::min(keep, oldCapacity - fInReadFrame);
+        std::memcpy(newBuffer.get(), fInBuffer.get() + fInReadFrame * fChannels,
+                    static_cast<size_t>(firstLen * fChannels) * sizeof(float));
+        std::memcpy(newBuffer.get() + firstLen * fChannels, fInBuffer.get(),
+                    static_cast<size_t>((keep - firstLen) * fChannels) * sizeof(float));
     }
-    return len;
+    fInBuffer.swap(newBuffer);
+    fInFrameMask = frames - 1;
+    fInReadFrame = 0;
+    fInFrames = keep;
 }
 
-void Aulib::Resampler_priv::fAdjustBufferSizes()
+auto Aulib::Resampler_priv::fFillInBuffer(bool& eof) -> int
 {
-    int oldInBufLen = fInBufferEnd - fInBufferPos;
-    int outBufSiz = fChannels * fChunkSize;
-    int inBufSiz;
-
-    if (fDstRate == fSrcRate) {
-        // In the no-op case where we don't actually resample, input and output
-        // buffers have the same size, since we're just copying the samples
-        // as-is from input to output.
-        inBufSiz = outBufSiz;
-    } else {
-        // When resampling, the input buffer's size depends on the ratio between
-        // the source and destination sample rates.
-        inBufSiz = std::ceil(static_cast<float>(outBufSiz) * fSrcRate / fDstRate);
-        auto remainder = inBufSiz % fChannels;
-        if (remainder != 0) {
-            inBufSiz = inBufSiz + fChannels - remainder;
-        }
-    }
-
-    fOutBuffer.reset(outBufSiz);
-    fInBuffer.resize(inBufSiz);
-    fOutBufferPos = fOutBufferEnd = fInBufferPos = 0;
-    if (oldInBufLen != 0) {
-        fInBufferEnd = oldInBufLen;
-    } else {
-        fInBufferEnd = 0;
+    const int capacity = fInFrameMask + 1;
+    const int writeFrame = (fInReadFrame + fInFrames) & fInFrameMask;
+    const int frames = std::min(capacity - fInFrames, capacity - writeFrame);
+
+    bool callAgain = false;
+    const int len = fDecoder->decode(fInBuffer.get() + writeFrame * fChannels, frames * fChannels,
+                                     callAgain);
+    const int decFrames = std::max(0, len) / fChannels;
+    fInFrames += decFrames;
+    // If the decoder indicated a spec change, what we have buffered so far still needs to be
+    // resampled using the current spec.
+    if (callAgain) {
+        fPendingSpecChange = true;
+    } else if (len <= 0) {
+        eof = true;
     }
+    return decFrames;
 }
 
-void Aulib::Resampler_priv::fResampleFromInBuffer()
+auto Aulib::Resampler_priv::fResampleFromInBuffer(float dst[], const int dstLen, int& consumed)
+    -> int
 {
-    int inLen = fInBufferEnd - fInBufferPos;
-    float* from = fInBuffer.get() + fInBufferPos;
-    float* to = fOutBuffer.get() + fOutBufferEnd;
+    const int frames = std::min(fInFrames, fInFrameMask + 1 - fInReadFrame);
+    const float* const from = fInBuffer.get() + fInReadFrame * fChannels;
+    int inLen = frames * fChannels;
+    int outLen = dstLen;
+
     if (fSrcRate == fDstRate) {
         // No resampling is needed. Just copy the samples as-is.
-        int outLen = std::min(fOutBuffer.size() - fOutBufferEnd, inLen);
-        std::memcpy(to, from, static_cast<size_t>(outLen) * sizeof(*from));
-        fOutBufferEnd += outLen;
-        fInBufferPos += outLen;
+        outLen = inLen = std::min(inLen, outLen - outLen % fChannels);
+        std::memcpy(dst, from, static_cast<size_t>(outLen) * sizeof(*from));
     } else {
-        int outLen = fOutBuffer.size() - fOutBufferEnd;
-        q->doResampling(to, from, outLen, inLen);
-        fOutBufferEnd += outLen;
-        fInBufferPos += inLen;
-    }
-    if (fInBufferPos >= fInBufferEnd) {
-        // No more samples left to resample. Mark the input buffer as empty.
-        fInBufferPos = fInBufferEnd = 0;
+        q->doResampling(dst, from, outLen, inLen);
     }
+
+    consumed = inLen / fChannels;
+    fInFrames -= consumed;
+    // Start over at the beginning when empty, so that the next decode gets the whole buffer.
+    fInReadFrame = fInFrames > 0 ? (fInReadFrame + consumed) & fInFrameMask : 0;
+    return outLen;
 }
 
 Aulib::Resampler::Resampler()
@@ -196,63 +174,51 @@ auto Aulib::Resampler::resample(float dst[], int dstLen) -> int
     int totalSamples = 0;
     bool decEOF = false;
 
-    if (d->fPendingSpecChange) {
-        // There's a spec change pending. Process any data that is still in our
-        // buffers using the current spec.
-        totalSamples += d->fMoveFromOutBuffer(dst, dstLen);
-        relocateBuffer(d->fOutBuffer.get(), d->fOutBufferPos, d->fOutBufferEnd);
-        d->fResampleFromInBuffer();
-        if (totalSamples >= dstLen) {
-            // There's still samples left in the output buffer, so don't change
-            // the spec yet.
-            return dstLen;
-        }
-        // Our buffers are empty, so we can change to the new spec.
-        setSpec(d->fDstRate, d->fChannels, d->fChunkSize);
-        d->fPendingSpecChange = false;
-    }
-
     // Keep resampling until we either produce the requested amount of output
     // samples, or the decoder has no more samples to give us.
-    while (totalSamples < dstLen and not decEOF) {
-        // If the input buffer is not filled, get some more samples from the
-        // decoder.
-        if (d->fInBufferEnd < d->fInBuffer.size()) {
+    while (totalSamples < dstLen) {
+        if (d->fSrcRate == d->fDstRate and d->fInFrames == 0 and not d->fPendingSpecChange) {
+            // Nothing to resample and nothing buffered, so decode straight into the output.
             bool callAgain = false;
-            int decSamples = d->fDecoder->decode(d->fInBuffer.get() + d->fInBufferEnd,
-                                                 d->fInBuffer.size() - d->fInBufferEnd, callAgain);
-            // If the decoder indicated a spec change, process any data that is
-            // still in our buffers using the current spec.
+            const int len =
+                d->fDecoder->decode(dst + totalSamples, dstLen - totalSamples, callAgain);
+            totalSamples += std::max(0, len);
             if (callAgain) {
-                d->fInBufferEnd += decSamples;
-                d->fResampleFromInBuffer();
-                totalSamples += d->fMoveFromOutBuffer(dst + totalSamples, dstLen - totalSamples);
-                if (totalSamples >= dstLen) {
-                    // There's still samples left in the output buffer. Keep
-                    // the current spec and prepare to change it on our next
-                    // call.
-                    d->fPendingSpecChange = true;
-                    return dstLen;
-                }
                 setSpec(d->fDstRate, d->fChannels, d->fChunkSize);
-            } else if (decSamples <= 0) {
-                decEOF = true;
-            } else {
-                d->fInBufferEnd += decSamples;
+            } else if (len <= 0) {
+                break;
             }
+            continue;
         }
 
-        d->fResampleFromInBuffer();
-        relocateBuffer(d->fInBuffer.get(), d->fInBufferPos, d->fInBufferEnd);
-        totalSamples += d->fMoveFromOutBuffer(dst + totalSamples, dstLen - totalSamples);
-        relocateBuffer(d->fOutBuffer.get(), d->fOutBufferPos, d->fOutBufferEnd);
+        bool madeProgress = false;
+        if (d->fInFrames > 0) {
+            int consumed = 0;
+            const int len =
+                d->fResampleFromInBuffer(dst + totalSamples, dstLen - totalSamples, consumed);
+            totalSamples += len;
+            madeProgress = len > 0 or consumed > 0;
+        }
+        if (d->fPendingSpecChange) {
+            if (d->fInFrames == 0) {
+                // Everything decoded with the old spec is out, so we can switch to the new one.
+                setSpec(d->fDstRate, d->fChannels, d->fChunkSize);
+                d->fPendingSpecChange = false;
+                continue;
+            }
+        } else if (not decEOF and d->fInFrames <= d->fInFrameMask) {
+            madeProgress |= d->fFillInBuffer(decEOF) > 0 or d->fPendingSpecChange;
+        }
+        if (not madeProgress) {
+            break;
+        }
     }
     return totalSamples;
 }
 
 void Aulib::Resampler::discardPendingSamples()
 {
-    d->fOutBufferPos = d->fOutBufferEnd = d->fInBufferPos = d->fInBufferEnd = 0;
+    d->fInReadFrame = d->fInFrames = 0;
     doDiscardPendingSamples();
 }
 
@@ -0,0 +1,128 @@
+// This is copyrighted software. More information is at the end of this file.
+#pragma once
+
+#include "aulib_debug.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+/*
+ * Fixed-size, lock-free ring buffer for one producer and one consumer thread. The producer only
+ * calls writeAvailable() and push(), the consumer only readAvailable() and pop(). Neither side
+ * ever blocks or allocates.
+ */
+template <typename T>
+class RingBuffer final
+{
+    static_assert(std::is_trivially_copyable<T>::value, "");
+
+public:
+    explicit RingBuffer(const int capacity)
+        : fCapacity(roundUpToPow2(capacity))
+        , fData(std::make_unique<T[]>(fCapacity))
+    {
+        AM_debugAssert(capacity > 0);
+    }
+
+    RingBuffer(const RingBuffer&) = delete;
+    auto operator=(const RingBuffer&) -> RingBuffer& = delete;
+
+    auto capacity() const noexcept -> int
+    {
+        return static_cast<int>(fCapacity);
+    }
+
+    auto writeAvailable() const noexcept -> int
+    {
+        return static_cast<int>(
+            fCapacity
+            - (fWritePos.load(std::memory_order_relaxed) - fReadPos.load(std::memory_order_acquire)));
+    }
+
+    auto readAvailable() const noexcept -> int
+    {
+        return static_cast<int>(fWritePos.load(std::memory_order_acquire)
+                                - fReadPos.load(std::memory_order_relaxed));
+    }
+
+    // Returns the amount of elements actually written.
+    auto push(const T src[], int len) noexcept -> int
+    {
+        len = std::min(len, writeAvailable());
+        const size_t pos = fWritePos.load(std::memory_order_relaxed);
+        copyIn(pos, src, len);
+        fWritePos.store(pos + len, std::memory_order_release);
+        return len;
+    }
+
+    // Returns the amount of elements actually read.
+    auto pop(T dst[], int len) noexcept -> int
+    {
+        len = std::min(len, readAvailable());
+        const size_t pos = fReadPos.load(std::memory_order_relaxed);
+        copyOut(pos, dst, len);
+        fReadPos.store(pos + len, std::memory_order_release);
+        return len;
+    }
+
+    // Only safe to call when neither the producer nor the consumer is active.
+    void clear() noexcept
+    {
+        fReadPos.store(fWritePos.load());
+    }
+
+private:
+    const size_t fCapacity;
+    std::unique_ptr<T[]> fData;
+    std::atomic<size_t> fWritePos{0};
+    std::atomic<size_t> fReadPos{0};
+
+    static auto roundUpToPow2(const int n) noexcept -> size_t
+    {
+        size_t cap = 1;
+        while (cap < static_cast<size_t>(n)) {
+            cap <<= 1;
+        }
+        return cap;
+    }
+
+    void copyIn(const size_t pos, const T src[], const int len) noexcept
+    {
+        const size_t start = pos & (fCapacity - 1);
+        const size_t first = std::min(static_cast<size_t>(len), fCapacity - start);
+        std::memcpy(fData.get() + start, src, first * sizeof(T));
+        std::memcpy(fData.get(), src + first, (len - first) * sizeof(T));
+    }
+
+    void copyOut(const size_t pos, T dst[], const int len) const noexcept
+    {
+        const size_t start = pos & (fCapacity - 1);
+        const size_t first = std::min(static_cast<size_t>(len), fCapacity - start);
+        std::memcpy(dst, fData.get() + start, first * sizeof(T));
+        std::memcpy(dst + first, fData.get(), (len - first) * sizeof(T));
+    }
+};
+
+/*
+
+Copyright (C) 2014, 2015, 2016, 2017, 2018, 2019 Nikos Chantziaras.
+
+This file is part of SDL_audiolib.
+
+SDL_audiolib is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the Free
+Software Foundation, either version 3 of the License, or (at your option) any
+later version.
+
+SDL_audiolib is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with SDL_audiolib. If not, see <http://www.gnu.org/licenses/>.
+
+*/
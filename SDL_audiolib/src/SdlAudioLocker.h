@@ -3,6 +3,8 @@
 
 #include "stream_p.h"
 #include <SDL_audio.h>
+#include <SDL_timer.h>
+#include <mutex>
 
 /*
  * RAII wrapper for SDL_LockAudio().
@@ -13,11 +15,22 @@ public:
     SdlAudioLocker()
     {
 #if SDL_VERSION_ATLEAST(2, 0, 0)
-        SDL_LockAudioDevice(Aulib::Stream_priv::fDeviceId);
+        if (not Aulib::Stream_priv::fInCallback) {
+            fDeviceLock = std::unique_lock<std::recursive_mutex>(Aulib::Stream_priv::fDeviceMutex);
+        }
+        // There's no device when rendering offline. We unlock the same device we locked here.
+        fDeviceId = Aulib::Stream_priv::fDeviceId;
+        if (fDeviceId != 0) {
+            SDL_LockAudioDevice(fDeviceId);
+        }
 #else
         SDL_LockAudio();
 #endif
         fIsLocked = true;
+        // The audio callback can't run while we hold the lock, so keep track of how long that is.
+        if (Aulib::Stream_priv::fCollectStats) {
+            fLockTicks = SDL_GetPerformanceCounter();
+        }
     }
 
     ~SdlAudioLocker()
@@ -31,8 +44,17 @@ public:
     void unlock()
     {
         if (fIsLocked) {
+            if (fLockTicks != 0) {
+                Aulib::Stream_priv::fRaiseMax(Aulib::Stream_priv::fStatsMaxLockTicks,
+                                              SDL_GetPerformanceCounter() - fLockTicks);
+            }
 #if SDL_VERSION_ATLEAST(2, 0, 0)
-            SDL_UnlockAudioDevice(Aulib::Stream_priv::fDeviceId);
+            if (fDeviceId != 0) {
+                SDL_UnlockAudioDevice(fDeviceId);
+            }
+            if (fDeviceLock.owns_lock()) {
+                fDeviceLock.unlock();
+            }
 #else
             SDL_UnlockAudio();
 #endif
@@ -42,6 +64,11 @@ public:
 
 private:
     bool fIsLocked;
+    Uint64 fLockTicks = 0;
+#if SDL_VERSION_ATLEAST(2, 0, 0)
+    SDL_AudioDeviceID fDeviceId = 0;
+    std::unique_lock<std::recursive_mutex> fDeviceLock;
+#endif
 };
 
 /*
@@ -12,8 +12,8 @@
 #include "sampleconv.h"
 #include "stream_p.h"
 #include <SDL_audio.h>
-#include <SDL_timer.h>
-#include <mutex>
+#include <algorithm>
+#include <optional>
 
 Aulib::Stream::Stream(const std::string& filename, std::unique_ptr<Decoder> decoder,
                       std::unique_ptr<Resampler> resampler)
@@ -43,14 +43,17 @@ Aulib::Stream::~Stream()
 
 auto Aulib::Stream::open() -> bool
 {
-    SdlAudioLocker lock;
-
     if (d->fIsOpen) {
         return true;
     }
+    // A stream that isn't open can't be playing, so the audio callback doesn't touch the decoder
+    // yet. Opening it can take a while, so don't block the callback during that.
     if (not d->fDecoder->open(d->fRWops)) {
         return false;
     }
+
+    SdlAudioLocker lock;
+
     if (d->fResampler) {
         d->fResampler->setSpec(Aulib::sampleRate(), Aulib::channelCount(), Aulib::frameSize());
     }
@@ -60,35 +63,13 @@ auto Aulib::Stream::open() -> bool
 
 auto Aulib::Stream::play(int iterations, std::chrono::microseconds fadeTime) -> bool
 {
-    if (not open()) {
-        return false;
-    }
-
-    SdlAudioLocker locker;
+    return d->fPlay(this, std::nullopt, iterations, fadeTime);
+}
 
-    if (d->fIsPlaying) {
-        return true;
-    }
-    d->fCurrentIteration = 0;
-    d->fWantedIterations = iterations;
-    d->fPlaybackStartTick = SDL_GetTicks();
-    d->fStarting = true;
-    if (fadeTime.count() > 0) {
-        d->fInternalVolume = 0.f;
-        d->fFadingIn = true;
-        d->fFadingOut = false;
-        d->fFadeInDuration = std::chrono::duration_cast<std::chrono::milliseconds>(fadeTime);
-        d->fFadeInStartTick = d->fPlaybackStartTick;
-    } else {
-        d->fInternalVolume = 1.f;
-        d->fFadingIn = false;
-    }
-    d->fIsPlaying = true;
-    {
-        std::lock_guard<SdlMutex> lock(d->fStreamListMutex);
-        d->fStreamList.push_back(this);
-    }
-    return true;
+auto Aulib::Stream::playAt(const Uint64 frame, int iterations, std::chrono::microseconds fadeTime)
+    -> bool
+{
+    return d->fPlay(this, frame, iterations, fadeTime);
 }
 
 void Aulib::Stream::stop(std::chrono::microseconds fadeTime)
@@ -99,7 +80,7 @@ void Aulib::Stream::stop(std::chrono::microseconds fadeTime)
         d->fFadingIn = false;
         d->fFadingOut = true;
         d->fFadeOutDuration = std::chrono::duration_cast<std::chrono::milliseconds>(fadeTime);
-        d->fFadeOutStartTick = SDL_GetTicks();
+        d->fFadeOutStartFrame = Stream_priv::fDeviceFrames;
         d->fStopAfterFade = true;
     } else {
         d->fStop();
@@ -121,7 +102,7 @@ void Aulib::Stream::pause(std::chrono::microseconds fadeTime)
         d->fFadingIn = false;
         d->fFadingOut = true;
         d->fFadeOutDuration = std::chrono::duration_cast<std::chrono::milliseconds>(fadeTime);
-        d->fFadeOutStartTick = SDL_GetTicks();
+        d->fFadeOutStartFrame = Stream_priv::fDeviceFrames;
         d->fStopAfterFade = false;
     } else {
         d->fIsPaused = true;
@@ -140,7 +121,7 @@ void Aulib::Stream::resume(std::chrono::microseconds fadeTime)
         d->fFadingIn = true;
         d->fFadingOut = false;
         d->fFadeInDuration = std::chrono::duration_cast<std::chrono::milliseconds>(fadeTime);
-        d->fFadeInStartTick = SDL_GetTicks();
+        d->fFadeInStartFrame = Stream_priv::fDeviceFrames;
     } else {
         d->fInternalVolume = 1.f;
     }
@@ -153,8 +134,16 @@ auto Aulib::Stream::rewind() -> bool
         return false;
     }
 
-    SdlAudioLocker locker;
-    return d->fDecoder->rewind();
+    auto decoderLock = d->fLockDecoder();
+    std::optional<SdlAudioLocker> locker;
+    d->fLockCallbackDecoding(locker);
+
+    if (not d->fDecoder->rewind()) {
+        return false;
+    }
+    // Drop audio that was decoded ahead from the old position.
+    d->fClearAheadRing();
+    return true;
 }
 
 void Aulib::Stream::setVolume(float volume)
@@ -164,6 +153,9 @@ void Aulib::Stream::setVolume(float volume)
     if (volume < 0.f) {
         volume = 0.f;
     }
+    // Ramp from wherever the volume currently is.
+    d->fVolumeRampStart = d->fIsPlaying ? d->fVolumeAt(Stream_priv::fDeviceFrames) : volume;
+    d->fVolumeRampStartFrame = Stream_priv::fDeviceFrames;
     d->fVolume = volume;
 }
 
@@ -225,16 +217,64 @@ auto Aulib::Stream::isPaused() const -> bool
 
 auto Aulib::Stream::duration() const -> std::chrono::microseconds
 {
-    SdlAudioLocker locker;
+    auto decoderLock = d->fLockDecoder();
+    std::optional<SdlAudioLocker> locker;
+    d->fLockCallbackDecoding(locker);
 
     return d->fDecoder->duration();
 }
 
 auto Aulib::Stream::seekToTime(std::chrono::microseconds pos) -> bool
+{
+    auto decoderLock = d->fLockDecoder();
+    std::optional<SdlAudioLocker> locker;
+    d->fLockCallbackDecoding(locker);
+
+    if (not d->fDecoder->seekToTime(pos)) {
+        return false;
+    }
+    d->fClearAheadRing();
+    return true;
+}
+
+void Aulib::Stream::setDecodeAhead(const std::chrono::milliseconds bufferLength,
+                                   const std::chrono::milliseconds prefill)
 {
     SdlAudioLocker locker;
 
-    return d->fDecoder->seekToTime(pos);
+    d->fAheadLength = bufferLength;
+    d->fAheadPrefill = std::min(prefill, bufferLength);
+}
+
+void Aulib::Stream::setLoadGovernor(const bool enabled)
+{
+    SdlAudioLocker locker;
+
+    d->fGovernLoad = enabled;
+}
+
+void Aulib::Stream::setLoopRange(const Sint64 start, const Sint64 end)
+{
+    SdlAudioLocker locker;
+
+    d->fLoopStart = std::max<Sint64>(0, start);
+    d->fLoopEnd = end;
+}
+
+auto Aulib::Stream::underrunCount() const -> int
+{
+    return d->fUnderruns;
+}
+
+auto Aulib::Stream::takeStats() -> Stats
+{
+    Stats stats;
+    stats.decodeTime = Stream_priv::fTicksToTime(d->fDecodeTicks.exchange(0));
+    stats.resampleTime = Stream_priv::fTicksToTime(d->fResampleTicks.exchange(0));
+    stats.processTime = Stream_priv::fTicksToTime(d->fProcessTicks.exchange(0));
+    stats.mixTime = Stream_priv::fTicksToTime(d->fMixTicks.exchange(0));
+    stats.minAheadFill = d->fMinAheadFill.exchange(-1);
+    return stats;
 }
 
 void Aulib::Stream::setFinishCallback(Callback func)
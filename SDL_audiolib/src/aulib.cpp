@@ -9,15 +9,24 @@
 #include <SDL.h>
 #include <SDL_audio.h>
 #include <SDL_version.h>
+#include <algorithm>
+#include <mutex>
+#include <vector>
 
 enum class InitType
 {
     None,
     NoOutput,
+    Offline,
     Full,
 };
 
 static InitType gInitType = InitType::None;
+#if SDL_VERSION_ATLEAST(2, 0, 0)
+static std::string gDeviceName;
+#endif
+// Device underrun count at the last takeMixerStats() call.
+static int gStatsUnderrunBase = 0;
 
 extern "C" {
 static void sdlCallback(void* /*unused*/, Uint8 out[], int outLen)
@@ -26,45 +35,10 @@ static void sdlCallback(void* /*unused*/, Uint8 out[], int outLen)
 }
 }
 
-auto Aulib::init(int freq, AudioFormat format, int channels, int frameSize,
-                 const std::string& device) -> bool
+// Selects the float to output format converter for the format the device was opened with.
+static auto pickSampleConverter() -> bool
 {
-    if (gInitType != InitType::None) {
-        SDL_SetError("SDL_audiolib already initialized, cannot initialize again.");
-        return false;
-    }
-
-    if (SDL_InitSubSystem(SDL_INIT_AUDIO) != 0) {
-        return false;
-    }
-
-    // We only support mono and stereo at this point.
-    channels = std::min(std::max(1, channels), 2);
-
-    SDL_AudioSpec requestedSpec{};
-    requestedSpec.freq = freq;
-    requestedSpec.format = format;
-    requestedSpec.channels = channels;
-    requestedSpec.samples = frameSize;
-    requestedSpec.callback = ::sdlCallback;
-    Stream_priv::fAudioSpec = requestedSpec;
-#if SDL_VERSION_ATLEAST(2, 0, 0)
-    auto flags = SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_FORMAT_CHANGE;
-#    if SDL_VERSION_ATLEAST(2, 0, 9)
-    flags |= SDL_AUDIO_ALLOW_SAMPLES_CHANGE;
-#    endif
-    Stream_priv::fDeviceId = SDL_OpenAudioDevice(device.empty() ? nullptr : device.c_str(), false,
-                                                 &requestedSpec, &Stream_priv::fAudioSpec, flags);
-    if (Stream_priv::fDeviceId == 0) {
-        Aulib::quit();
-        return false;
-    }
-#else
-    if (SDL_OpenAudio(&requestedSpec, &Stream_priv::fAudioSpec) == -1) {
-        Aulib::quit();
-        return false;
-    }
-#endif
+    using Aulib::Stream_priv;
 
     aulib::log::debug("SDL initialized with sample format: ");
     switch (Stream_priv::fAudioSpec.format) {
@@ -112,6 +86,53 @@ auto Aulib::init(int freq, AudioFormat format, int channels, int frameSize,
 #endif
     default:
         aulib::log::warnLn("Unknown audio format spec: {}", Stream_priv::fAudioSpec.format);
+        return false;
+    }
+    return true;
+}
+
+auto Aulib::init(int freq, AudioFormat format, int channels, int frameSize,
+                 const std::string& device) -> bool
+{
+    if (gInitType != InitType::None) {
+        SDL_SetError("SDL_audiolib already initialized, cannot initialize again.");
+        return false;
+    }
+
+    if (SDL_InitSubSystem(SDL_INIT_AUDIO) != 0) {
+        return false;
+    }
+
+    // We only support mono and stereo at this point.
+    channels = std::min(std::max(1, channels), 2);
+
+    SDL_AudioSpec requestedSpec{};
+    requestedSpec.freq = freq;
+    requestedSpec.format = format;
+    requestedSpec.channels = channels;
+    requestedSpec.samples = frameSize;
+    requestedSpec.callback = ::sdlCallback;
+    Stream_priv::fAudioSpec = requestedSpec;
+#if SDL_VERSION_ATLEAST(2, 0, 0)
+    auto flags = SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_FORMAT_CHANGE;
+#    if SDL_VERSION_ATLEAST(2, 0, 9)
+    flags |= SDL_AUDIO_ALLOW_SAMPLES_CHANGE;
+#    endif
+    gDeviceName = device;
+    Stream_priv::fDeviceId = SDL_OpenAudioDevice(device.empty() ? nullptr : device.c_str(), false,
+                                                 &requestedSpec, &Stream_priv::fAudioSpec, flags);
+    if (Stream_priv::fDeviceId == 0) {
+        Aulib::quit();
+        return false;
+    }
+#else
+    if (SDL_OpenAudio(&requestedSpec, &Stream_priv::fAudioSpec) == -1) {
+        Aulib::quit();
+        return false;
+    }
+#endif
+
+    if (not pickSampleConverter()) {
         Aulib::quit();
         return false;
     }
@@ -140,17 +161,159 @@ auto Aulib::initWithoutOutput(const int freq, const int channels) -> bool
     return true;
 }
 
+auto Aulib::initOffline(const int freq, const AudioFormat format, int channels,
+                        const int frameSize) -> bool
+{
+    if (gInitType != InitType::None) {
+        SDL_SetError("SDL_audiolib already initialized, cannot initialize again.");
+        return false;
+    }
+
+    channels = std::min(std::max(1, channels), 2);
+
+    Stream_priv::fAudioSpec = SDL_AudioSpec{};
+    Stream_priv::fAudioSpec.freq = freq;
+    Stream_priv::fAudioSpec.format = format;
+    Stream_priv::fAudioSpec.channels = channels;
+    Stream_priv::fAudioSpec.samples = frameSize;
+    if (not pickSampleConverter()) {
+        SDL_SetError("Unsupported sample format.");
+        return false;
+    }
+#if SDL_VERSION_ATLEAST(2, 0, 0)
+    Stream_priv::fDeviceId = 0;
+#endif
+    Stream_priv::fOffline = true;
+    Stream_priv::fDeviceFrames = 0;
+    gInitType = InitType::Offline;
+    std::atexit(Aulib::quit);
+    return true;
+}
+
+auto Aulib::renderOffline(Uint8 out[], const int len) -> bool
+{
+    if (gInitType != InitType::Offline) {
+        SDL_SetError("SDL_audiolib is not initialized for offline rendering.");
+        return false;
+    }
+    Stream_priv::fSdlCallbackImpl(nullptr, out, len);
+    return true;
+}
+
+// Writes the header of a WAV file holding 'frames' frames of audio in the current output format.
+static auto writeWavHeader(SDL_RWops* rwops, const Uint16 wavFormat, const Uint32 frames) -> bool
+{
+    const auto& spec = Aulib::Stream_priv::fAudioSpec;
+    const Uint16 bits = SDL_AUDIO_BITSIZE(spec.format);
+    const Uint16 block_align = bits / 8 * spec.channels;
+    const Uint32 data_bytes = frames * block_align;
+    // Formats other than integer PCM need the extension size field and a fact chunk.
+    const bool is_pcm = wavFormat == 1;
+    const Uint32 fmt_size = is_pcm ? 16 : 18;
+    const Uint32 riff_size = 4 + (8 + fmt_size) + (is_pcm ? 0 : 12) + (8 + data_bytes);
+
+    bool ok = SDL_RWwrite(rwops, "RIFF", 4, 1) == 1;
+    ok = ok and SDL_WriteLE32(rwops, riff_size) == 1;
+    ok = ok and SDL_RWwrite(rwops, "WAVEfmt ", 8, 1) == 1;
+    ok = ok and SDL_WriteLE32(rwops, fmt_size) == 1;
+    ok = ok and SDL_WriteLE16(rwops, wavFormat) == 1;
+    ok = ok and SDL_WriteLE16(rwops, spec.channels) == 1;
+    ok = ok and SDL_WriteLE32(rwops, spec.freq) == 1;
+    ok = ok and SDL_WriteLE32(rwops, spec.freq * block_align) == 1;
+    ok = ok and SDL_WriteLE16(rwops, block_align) == 1;
+    ok = ok and SDL_WriteLE16(rwops, bits) == 1;
+    if (not is_pcm) {
+        ok = ok and SDL_WriteLE16(rwops, 0) == 1;
+        ok = ok and SDL_RWwrite(rwops, "fact", 4, 1) == 1;
+        ok = ok and SDL_WriteLE32(rwops, 4) == 1;
+        ok = ok and SDL_WriteLE32(rwops, frames) == 1;
+    }
+    ok = ok and SDL_RWwrite(rwops, "data", 4, 1) == 1;
+    ok = ok and SDL_WriteLE32(rwops, data_bytes) == 1;
+    return ok;
+}
+
+auto Aulib::renderToFile(const std::string& filename, const std::chrono::microseconds maxLength)
+    -> Sint64
+{
+    if (gInitType != InitType::Offline) {
+        SDL_SetError("SDL_audiolib is not initialized for offline rendering.");
+        return -1;
+    }
+
+    const auto& spec = Stream_priv::fAudioSpec;
+    Uint16 wav_format = 0;
+    switch (spec.format) {
+    case AUDIO_U8:
+    case AUDIO_S16LSB:
+#if SDL_VERSION_ATLEAST(2, 0, 0)
+    case AUDIO_S32LSB:
+#endif
+        wav_format = 1;
+        break;
+#if SDL_VERSION_ATLEAST(2, 0, 0)
+    case AUDIO_F32LSB:
+        wav_format = 3;
+        break;
+#endif
+    default:
+        SDL_SetError("The output sample format can't be stored in WAV files.");
+        return -1;
+    }
+
+    SDL_RWops* rwops = SDL_RWFromFile(filename.c_str(), "wb");
+    if (rwops == nullptr) {
+        return -1;
+    }
+    // The sizes in the header are filled in once we know them.
+    if (not writeWavHeader(rwops, wav_format, 0)) {
+        SDL_RWclose(rwops);
+        return -1;
+    }
+
+    const int frame_bytes = SDL_AUDIO_BITSIZE(spec.format) / 8 * spec.channels;
+    std::vector<Uint8> buf(spec.samples * frame_bytes);
+    const Sint64 max_frames = maxLength.count() * spec.freq / 1000000;
+    const auto isPlaying = [](const std::atomic<Stream*>& slot) { return slot != nullptr; };
+    Sint64 frames = 0;
+    while (frames < max_frames
+           and std::any_of(Stream_priv::fStreamSlots.begin(), Stream_priv::fStreamSlots.end(),
+                           isPlaying)) {
+        const int len = static_cast<int>(std::min<Sint64>(spec.samples, max_frames - frames))
+                        * frame_bytes;
+        Stream_priv::fSdlCallbackImpl(nullptr, buf.data(), len);
+        if (SDL_RWwrite(rwops, buf.data(), len, 1) != 1) {
+            SDL_RWclose(rwops);
+            return -1;
+        }
+        frames += len / frame_bytes;
+    }
+
+    const bool ok = SDL_RWseek(rwops, 0, RW_SEEK_SET) == 0
+                    and writeWavHeader(rwops, wav_format, static_cast<Uint32>(frames));
+    if (SDL_RWclose(rwops) != 0 or not ok) {
+        return -1;
+    }
+    return frames;
+}
+
 void Aulib::quit()
 {
     if (gInitType == InitType::None) {
         return;
     }
+    if (gInitType == InitType::Offline) {
+        Stream_priv::fOffline = false;
+    } else {
 #if SDL_VERSION_ATLEAST(2, 0, 0)
-    SDL_CloseAudioDevice(Stream_priv::fDeviceId);
+        std::lock_guard<std::recursive_mutex> device_lock(Stream_priv::fDeviceMutex);
+        SDL_CloseAudioDevice(Stream_priv::fDeviceId);
+        Stream_priv::fDeviceId = 0;
 #else
-    SDL_CloseAudio();
+        SDL_CloseAudio();
 #endif
-    SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+    }
     Stream_priv::fSampleConverter = nullptr;
     gInitType = InitType::None;
 }
@@ -175,6 +338,106 @@ auto Aulib::frameSize() noexcept -> int
     return Stream_priv::fAudioSpec.samples;
 }
 
+auto Aulib::setFrameSize(const int frameSize) -> bool
+{
+    if (gInitType == InitType::Offline) {
+        Stream_priv::fAudioSpec.samples = frameSize;
+        return true;
+    }
+    if (gInitType != InitType::Full) {
+        SDL_SetError("SDL_audiolib is not initialized with audio output.");
+        return false;
+    }
+    if (frameSize == Stream_priv::fAudioSpec.samples) {
+        return true;
+    }
+#if SDL_VERSION_ATLEAST(2, 0, 0)
+    // Ask for exactly what we have now, except for the frame size. Streams stay in their slots
+    // while the device is closed, so they continue where they left off once it's open again.
+    const SDL_AudioSpec oldSpec = Stream_priv::fAudioSpec;
+    SDL_AudioSpec requestedSpec = oldSpec;
+    requestedSpec.samples = frameSize;
+    requestedSpec.callback = ::sdlCallback;
+    const char* const device = gDeviceName.empty() ? nullptr : gDeviceName.c_str();
+    int flags = 0;
+#    if SDL_VERSION_ATLEAST(2, 0, 9)
+    flags |= SDL_AUDIO_ALLOW_SAMPLES_CHANGE;
+#    endif
+
+    // Lockers in other threads must not have the old device locked when it's closed, and must
+    // not pick up the id before the new one is open.
+    std::lock_guard<std::recursive_mutex> device_lock(Stream_priv::fDeviceMutex);
+    SDL_CloseAudioDevice(Stream_priv::fDeviceId);
+    Stream_priv::fDeviceId =
+        SDL_OpenAudioDevice(device, false, &requestedSpec, &Stream_priv::fAudioSpec, flags);
+    if (Stream_priv::fDeviceId == 0) {
+        aulib::log::warnLn("Failed to reopen audio device with frame size {}: {}", frameSize,
+                           SDL_GetError());
+        requestedSpec.samples = oldSpec.samples;
+        Stream_priv::fDeviceId =
+            SDL_OpenAudioDevice(device, false, &requestedSpec, &Stream_priv::fAudioSpec, flags);
+        if (Stream_priv::fDeviceId == 0) {
+            Aulib::quit();
+            return false;
+        }
+    }
+    Stream_priv::fLastCallbackTime = 0;
+    SDL_PauseAudioDevice(Stream_priv::fDeviceId, false);
+    return Stream_priv::fAudioSpec.samples == frameSize;
+#else
+    SDL_SetError("Changing the frame size requires SDL 2.");
+    return false;
+#endif
+}
+
+auto Aulib::underrunCount() noexcept -> int
+{
+    return Stream_priv::fDeviceUnderruns;
+}
+
+auto Aulib::deviceFrame() noexcept -> Uint64
+{
+    return Stream_priv::fDeviceFrames;
+}
+
+void Aulib::setStatsEnabled(const bool enabled) noexcept
+{
+    if (enabled and not Stream_priv::fCollectStats) {
+        // Start from zero rather than from whatever was left over from the last time.
+        takeMixerStats();
+    }
+    Stream_priv::fCollectStats = enabled;
+}
+
+auto Aulib::statsEnabled() noexcept -> bool
+{
+    return Stream_priv::fCollectStats;
+}
+
+auto Aulib::takeMixerStats() -> MixerStats
+{
+    MixerStats stats;
+    stats.callbacks = Stream_priv::fStatsCallbacks.exchange(0);
+    if (Stream_priv::fAudioSpec.freq > 0) {
+        stats.deadline = std::chrono::microseconds(Stream_priv::fAudioSpec.samples * 1000000LL
+                                                   / Stream_priv::fAudioSpec.freq);
+    }
+    const Uint64 callback_ticks = Stream_priv::fStatsCallbackTicks.exchange(0);
+    if (stats.callbacks > 0) {
+        stats.averageCallbackTime = Stream_priv::fTicksToTime(callback_ticks / stats.callbacks);
+    }
+    stats.maxCallbackTime =
+        Stream_priv::fTicksToTime(Stream_priv::fStatsMaxCallbackTicks.exchange(0));
+    for (size_t i = 0; i < stats.callbackHistogram.size(); ++i) {
+        stats.callbackHistogram[i] = Stream_priv::fStatsHistogram[i].exchange(0);
+    }
+    const int underruns = Stream_priv::fDeviceUnderruns;
+    stats.underruns = underruns - gStatsUnderrunBase;
+    gStatsUnderrunBase = underruns;
+    stats.maxLockTime = Stream_priv::fTicksToTime(Stream_priv::fStatsMaxLockTicks.exchange(0));
+    return stats;
+}
+
 /*
 
 Copyright (C) 2014, 2015, 2016, 2017, 2018, 2019 Nikos Chantziaras.
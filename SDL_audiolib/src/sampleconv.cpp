@@ -6,6 +6,29 @@
 #include <SDL_endian.h>
 #include <SDL_version.h>
 #include <limits>
+#include <type_traits>
+
+// The scalar kernels must give the same results as the SIMD ones, which multiply and add
+// separately. Fusing them into an FMA rounds differently. The build also passes
+// -ffp-contract=off, since GCC doesn't support this pragma.
+#if defined(__clang__)
+#    pragma STDC FP_CONTRACT OFF
+#elif defined(_MSC_VER)
+#    pragma fp_contract(off)
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define AULIB_SSE2 1
+#    include <emmintrin.h>
+#endif
+#if AULIB_SSE2 && defined(__GNUC__)
+#    define AULIB_AVX2 1
+#    include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#    define AULIB_NEON 1
+#    include <arm_neon.h>
+#endif
 
 /* Convert and clip a float sample to an integer sample. This works for
  * all supported integer sample types (8-bit, 16-bit, 32-bit, signed or
@@ -25,18 +48,443 @@ static constexpr auto floatSampleToInt(const float src) noexcept -> T
               + static_cast<float>(std::numeric_limits<T>::min()));
 }
 
-/* Convert float samples into integer samples.
+/*
+ * Scalar reference kernels. The SIMD versions below must produce bit-identical results.
  */
 template <typename T>
-static void floatToInt(Uint8 dst[], const Buffer<float>& src) noexcept
+static void floatToIntScalar(Uint8 dst[], const float src[], const int len) noexcept
 {
-    for (auto i : src) {
-        auto sample = floatSampleToInt<T>(i);
+    for (int i = 0; i < len; ++i) {
+        auto sample = floatSampleToInt<T>(src[i]);
         memcpy(dst, &sample, sizeof(sample));
         dst += sizeof(sample);
     }
 }
 
+static void mixWithGainScalar(float dst[], const float src[], const int len, const float gainLeft,
+                              const float gainRight) noexcept
+{
+    for (int i = 0; i < len; ++i) {
+        dst[i] += src[i] * (i % 2 == 0 ? gainLeft : gainRight);
+    }
+}
+
+static void mixWithEnvelopeScalar(float dst[], const float src[], const float env[], const int len,
+                                  const float gainLeft, const float gainRight) noexcept
+{
+    for (int i = 0; i < len; ++i) {
+        dst[i] += src[i] * (env[i] * (i % 2 == 0 ? gainLeft : gainRight));
+    }
+}
+
+static void s16ToFloatScalar(float dst[], const Sint16 src[], const int len) noexcept
+{
+    for (int i = 0; i < len; ++i) {
+        dst[i] = src[i] / 32768.f;
+    }
+}
+
+static void monoToStereoScalar(float buf[], const int monoLen) noexcept
+{
+    for (int i = monoLen - 1, j = monoLen * 2 - 1; i >= 0; --i) {
+        buf[j--] = buf[i];
+        buf[j--] = buf[i];
+    }
+}
+
+static void stereoToMonoScalar(float dst[], const float src[], const int monoLen) noexcept
+{
+    for (int i = 0, j = 0; j < monoLen; i += 2, ++j) {
+        dst[j] = src[i] * 0.5f;
+        dst[j] += src[i + 1] * 0.5f;
+    }
+}
+
+#if AULIB_SSE2
+/*
+ * SSE2 is part of the x86-64 baseline, so these don't need a runtime check. Float to int
+ * conversion truncates, just like the scalar version.
+ */
+static void floatToS16Sse2(Uint8 dst[], const float src[], const int len) noexcept
+{
+    const __m128 scale = _mm_set1_ps(32768.f);
+    const __m128 one = _mm_set1_ps(1.f);
+    int i = 0;
+    for (; i + 8 <= len; i += 8) {
+        // The pack saturates, but values too large for a 32-bit int convert to INT32_MIN, so
+        // clamp the top first. The bottom needs nothing; it ends up at INT32_MIN either way.
+        const __m128 in_lo = _mm_min_ps(_mm_loadu_ps(src + i), one);
+        const __m128 in_hi = _mm_min_ps(_mm_loadu_ps(src + i + 4), one);
+        const __m128i lo = _mm_cvttps_epi32(_mm_mul_ps(in_lo, scale));
+        const __m128i hi = _mm_cvttps_epi32(_mm_mul_ps(in_hi, scale));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 2), _mm_packs_epi32(lo, hi));
+    }
+    floatToIntScalar<Sint16>(dst + i * 2, src + i, len - i);
+}
+
+static void floatToS32Sse2(Uint8 dst[], const float src[], const int len) noexcept
+{
+    const __m128 scale = _mm_set1_ps(2147483648.f);
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128i max = _mm_set1_epi32(std::numeric_limits<Sint32>::max());
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+        const __m128 in = _mm_loadu_ps(src + i);
+        // Values below -1 convert to INT32_MIN on their own, but values of 1 and above need to be
+        // clamped manually.
+        const __m128i clip = _mm_castps_si128(_mm_cmpge_ps(in, one));
+        const __m128i conv = _mm_cvttps_epi32(_mm_mul_ps(in, scale));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4),
+                         _mm_or_si128(_mm_and_si128(clip, max), _mm_andnot_si128(clip, conv)));
+    }
+    floatToIntScalar<Sint32>(dst + i * 4, src + i, len - i);
+}
+
+static void mixWithGainSse2(float dst[], const float src[], const int len, const float gainLeft,
+                            const float gainRight) noexcept
+{
+    const __m128 gain = _mm_setr_ps(gainLeft, gainRight, gainLeft, gainRight);
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+        const __m128 mixed =
+            _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), gain));
+        _mm_storeu_ps(dst + i, mixed);
+    }
+    mixWithGainScalar(dst + i, src + i, len - i, gainLeft, gainRight);
+}
+
+static void mixWithEnvelopeSse2(float dst[], const float src[], const float env[], const int len,
+                                const float gainLeft, const float gainRight) noexcept
+{
+    const __m128 gain = _mm_setr_ps(gainLeft, gainRight, gainLeft, gainRight);
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+        const __m128 scale = _mm_mul_ps(_mm_loadu_ps(env + i), gain);
+        const __m128 mixed =
+            _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), scale));
+        _mm_storeu_ps(dst + i, mixed);
+    }
+    mixWithEnvelopeScalar(dst + i, src + i, env + i, len - i, gainLeft, gainRight);
+}
+
+static void s16ToFloatSse2(float dst[], const Sint16 src[], const int len) noexcept
+{
+    // Multiplying by a power of two is exact, so this matches the division in the scalar version.
+    const __m128 scale = _mm_set1_ps(1.f / 32768.f);
+    int i = 0;
+    for (; i + 8 <= len; i += 8) {
+        const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        // Sign-extend by moving each sample into the upper half of a 32-bit lane and shifting back.
+        const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(in, in), 16);
+        const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(in, in), 16);
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+    s16ToFloatScalar(dst + i, src + i, len - i);
+}
+
+static void monoToStereoSse2(float buf[], const int monoLen) noexcept
+{
+    // Work backwards so that we never overwrite mono samples we haven't read yet. Do the odd
+    // samples at the end first so that the vector loop below ends exactly at the start.
+    const int tail = monoLen % 4;
+    for (int i = monoLen - 1; i >= monoLen - tail; --i) {
+        buf[i * 2] = buf[i * 2 + 1] = buf[i];
+    }
+    for (int i = monoLen - tail - 4; i >= 0; i -= 4) {
+        const __m128 in = _mm_loadu_ps(buf + i);
+        _mm_storeu_ps(buf + i * 2 + 4, _mm_unpackhi_ps(in, in));
+        _mm_storeu_ps(buf + i * 2, _mm_unpacklo_ps(in, in));
+    }
+}
+
+static void stereoToMonoSse2(float dst[], const float src[], const int monoLen) noexcept
+{
+    const __m128 half = _mm_set1_ps(0.5f);
+    int j = 0;
+    for (; j + 4 <= monoLen; j += 4) {
+        const __m128 a = _mm_loadu_ps(src + j * 2);
+        const __m128 b = _mm_loadu_ps(src + j * 2 + 4);
+        const __m128 left = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128 right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(dst + j, _mm_add_ps(_mm_mul_ps(left, half), _mm_mul_ps(right, half)));
+    }
+    stereoToMonoScalar(dst + j, src + j * 2, monoLen - j);
+}
+#endif
+
+#if AULIB_AVX2
+/*
+ * AVX2 versions of the mixing and conversion kernels. Only used when the CPU supports it.
+ */
+__attribute__((target("avx2"))) static void floatToS16Avx2(Uint8 dst[], const float src[],
+                                                            const int len) noexcept
+{
+    const __m256 scale = _mm256_set1_ps(32768.f);
+    const __m256 one = _mm256_set1_ps(1.f);
+    int i = 0;
+    for (; i + 16 <= len; i += 16) {
+        const __m256 in_lo = _mm256_min_ps(_mm256_loadu_ps(src + i), one);
+        const __m256 in_hi = _mm256_min_ps(_mm256_loadu_ps(src + i + 8), one);
+        const __m256i lo = _mm256_cvttps_epi32(_mm256_mul_ps(in_lo, scale));
+        const __m256i hi = _mm256_cvttps_epi32(_mm256_mul_ps(in_hi, scale));
+        // The pack works per 128-bit lane, so the 64-bit quarters need to be put back in order.
+        const __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 2), packed);
+    }
+    floatToS16Sse2(dst + i * 2, src + i, len - i);
+}
+
+__attribute__((target("avx2"))) static void floatToS32Avx2(Uint8 dst[], const float src[],
+                                                            const int len) noexcept
+{
+    const __m256 scale = _mm256_set1_ps(2147483648.f);
+    const __m256 one = _mm256_set1_ps(1.f);
+    const __m256i max = _mm256_set1_epi32(std::numeric_limits<Sint32>::max());
+    int i = 0;
+    for (; i + 8 <= len; i += 8) {
+        const __m256 in = _mm256_loadu_ps(src + i);
+        const __m256i clip = _mm256_castps_si256(_mm256_cmp_ps(in, one, _CMP_GE_OQ));
+        const __m256i conv = _mm256_cvttps_epi32(_mm256_mul_ps(in, scale));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4),
+                            _mm256_blendv_epi8(conv, max, clip));
+    }
+    floatToS32Sse2(dst + i * 4, src + i, len - i);
+}
+
+__attribute__((target("avx2"))) static void s16ToFloatAvx2(float dst[], const Sint16 src[],
+                                                            const int len) noexcept
+{
+    const __m256 scale = _mm256_set1_ps(1.f / 32768.f);
+    int i = 0;
+    for (; i + 16 <= len; i += 16) {
+        const __m256i lo = _mm256_cvtepi16_epi32(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+        const __m256i hi = _mm256_cvtepi16_epi32(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8)));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(lo), scale));
+        _mm256_storeu_ps(dst + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(hi), scale));
+    }
+    s16ToFloatSse2(dst + i, src + i, len - i);
+}
+
+__attribute__((target("avx2"))) static void mixWithGainAvx2(float dst[], const float src[],
+                                                             const int len, const float gainLeft,
+                                                             const float gainRight) noexcept
+{
+    const __m256 gain = _mm256_setr_ps(gainLeft, gainRight, gainLeft, gainRight, gainLeft,
+                                       gainRight, gainLeft, gainRight);
+    int i = 0;
+    for (; i + 8 <= len; i += 8) {
+        const __m256 mixed =
+            _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_mul_ps(_mm256_loadu_ps(src + i), gain));
+        _mm256_storeu_ps(dst + i, mixed);
+    }
+    mixWithGainSse2(dst + i, src + i, len - i, gainLeft, gainRight);
+}
+
+__attribute__((target("avx2"))) static void
+mixWithEnvelopeAvx2(float dst[], const float src[], const float env[], const int len,
+                    const float gainLeft, const float gainRight) noexcept
+{
+    const __m256 gain = _mm256_setr_ps(gainLeft, gainRight, gainLeft, gainRight, gainLeft,
+                                       gainRight, gainLeft, gainRight);
+    int i = 0;
+    for (; i + 8 <= len; i += 8) {
+        const __m256 scale = _mm256_mul_ps(_mm256_loadu_ps(env + i), gain);
+        const __m256 mixed = _mm256_add_ps(_mm256_loadu_ps(dst + i),
+                                           _mm256_mul_ps(_mm256_loadu_ps(src + i), scale));
+        _mm256_storeu_ps(dst + i, mixed);
+    }
+    mixWithEnvelopeSse2(dst + i, src + i, env + i, len - i, gainLeft, gainRight);
+}
+#endif
+
+#if AULIB_NEON
+/*
+ * NEON float to int conversion truncates and saturates, which matches the scalar version without
+ * any extra clamping.
+ */
+static void floatToS16Neon(Uint8 dst[], const float src[], const int len) noexcept
+{
+    const float32x4_t scale = vdupq_n_f32(32768.f);
+    int i = 0;
+    for (; i + 8 <= len; i += 8) {
+        const int32x4_t lo = vcvtq_s32_f32(vmulq_f32(vld1q_f32(src + i), scale));
+        const int32x4_t hi = vcvtq_s32_f32(vmulq_f32(vld1q_f32(src + i + 4), scale));
+        const int16x8_t packed = vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi));
+        vst1q_u8(dst + i * 2, vreinterpretq_u8_s16(packed));
+    }
+    floatToIntScalar<Sint16>(dst + i * 2, src + i, len - i);
+}
+
+static void floatToS32Neon(Uint8 dst[], const float src[], const int len) noexcept
+{
+    const float32x4_t scale = vdupq_n_f32(2147483648.f);
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+        const int32x4_t conv = vcvtq_s32_f32(vmulq_f32(vld1q_f32(src + i), scale));
+        vst1q_u8(dst + i * 4, vreinterpretq_u8_s32(conv));
+    }
+    floatToIntScalar<Sint32>(dst + i * 4, src + i, len - i);
+}
+
+static void mixWithGainNeon(float dst[], const float src[], const int len, const float gainLeft,
+                            const float gainRight) noexcept
+{
+    const float gains[4] = {gainLeft, gainRight, gainLeft, gainRight};
+    const float32x4_t gain = vld1q_f32(gains);
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+        // Separate multiply and add. A fused multiply-add would round differently.
+        const float32x4_t scaled = vmulq_f32(vld1q_f32(src + i), gain);
+        vst1q_f32(dst + i, vaddq_f32(vld1q_f32(dst + i), scaled));
+    }
+    mixWithGainScalar(dst + i, src + i, len - i, gainLeft, gainRight);
+}
+
+static void mixWithEnvelopeNeon(float dst[], const float src[], const float env[], const int len,
+                                const float gainLeft, const float gainRight) noexcept
+{
+    const float gains[4] = {gainLeft, gainRight, gainLeft, gainRight};
+    const float32x4_t gain = vld1q_f32(gains);
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+        const float32x4_t scale = vmulq_f32(vld1q_f32(env + i), gain);
+        const float32x4_t scaled = vmulq_f32(vld1q_f32(src + i), scale);
+        vst1q_f32(dst + i, vaddq_f32(vld1q_f32(dst + i), scaled));
+    }
+    mixWithEnvelopeScalar(dst + i, src + i, env + i, len - i, gainLeft, gainRight);
+}
+
+static void s16ToFloatNeon(float dst[], const Sint16 src[], const int len) noexcept
+{
+    const float32x4_t scale = vdupq_n_f32(1.f / 32768.f);
+    int i = 0;
+    for (; i + 8 <= len; i += 8) {
+        const int16x8_t in = vld1q_s16(src + i);
+        vst1q_f32(dst + i, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(in))), scale));
+        vst1q_f32(dst + i + 4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(in))), scale));
+    }
+    s16ToFloatScalar(dst + i, src + i, len - i);
+}
+
+static void monoToStereoNeon(float buf[], const int monoLen) noexcept
+{
+    const int tail = monoLen % 4;
+    for (int i = monoLen - 1; i >= monoLen - tail; --i) {
+        buf[i * 2] = buf[i * 2 + 1] = buf[i];
+    }
+    for (int i = monoLen - tail - 4; i >= 0; i -= 4) {
+        const float32x4_t in = vld1q_f32(buf + i);
+        vst2q_f32(buf + i * 2, float32x4x2_t{{in, in}});
+    }
+}
+
+static void stereoToMonoNeon(float dst[], const float src[], const int monoLen) noexcept
+{
+    const float32x4_t half = vdupq_n_f32(0.5f);
+    int j = 0;
+    for (; j + 4 <= monoLen; j += 4) {
+        const float32x4x2_t in = vld2q_f32(src + j * 2);
+        vst1q_f32(dst + j, vaddq_f32(vmulq_f32(in.val[0], half), vmulq_f32(in.val[1], half)));
+    }
+    stereoToMonoScalar(dst + j, src + j * 2, monoLen - j);
+}
+#endif
+
+namespace {
+
+/*
+ * The best kernel for each operation, picked once based on what the CPU supports.
+ */
+struct Kernels final
+{
+    void (*toS16)(Uint8[], const float[], int) noexcept = floatToIntScalar<Sint16>;
+    void (*toS32)(Uint8[], const float[], int) noexcept = floatToIntScalar<Sint32>;
+    void (*mixWithGain)(float[], const float[], int, float, float) noexcept = mixWithGainScalar;
+    void (*mixWithEnvelope)(float[], const float[], const float[], int, float,
+                            float) noexcept = mixWithEnvelopeScalar;
+    void (*fromS16)(float[], const Sint16[], int) noexcept = s16ToFloatScalar;
+};
+
+auto pickKernels() noexcept -> Kernels
+{
+    Kernels k;
+#if AULIB_SSE2
+    k.toS16 = floatToS16Sse2;
+    k.toS32 = floatToS32Sse2;
+    k.mixWithGain = mixWithGainSse2;
+    k.mixWithEnvelope = mixWithEnvelopeSse2;
+    k.fromS16 = s16ToFloatSse2;
+#endif
+#if AULIB_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        k.toS16 = floatToS16Avx2;
+        k.toS32 = floatToS32Avx2;
+        k.mixWithGain = mixWithGainAvx2;
+        k.mixWithEnvelope = mixWithEnvelopeAvx2;
+        k.fromS16 = s16ToFloatAvx2;
+    }
+#endif
+#if AULIB_NEON
+    k.toS16 = floatToS16Neon;
+    k.toS32 = floatToS32Neon;
+    k.mixWithGain = mixWithGainNeon;
+    k.mixWithEnvelope = mixWithEnvelopeNeon;
+    k.fromS16 = s16ToFloatNeon;
+#endif
+    return k;
+}
+
+auto kernels() noexcept -> const Kernels&
+{
+    static const Kernels k = pickKernels();
+    return k;
+}
+
+} // namespace
+
+auto Aulib::sampleKernelSets() -> std::vector<SampleKernelSet>
+{
+    std::vector<SampleKernelSet> sets;
+    sets.push_back({"scalar", floatToIntScalar<Sint16>, floatToIntScalar<Sint32>,
+                    mixWithGainScalar, mixWithEnvelopeScalar, s16ToFloatScalar, monoToStereoScalar,
+                    stereoToMonoScalar});
+#if AULIB_SSE2
+    sets.push_back({"SSE2", floatToS16Sse2, floatToS32Sse2, mixWithGainSse2, mixWithEnvelopeSse2,
+                    s16ToFloatSse2, monoToStereoSse2, stereoToMonoSse2});
+#endif
+#if AULIB_AVX2
+    // There are no AVX2 channel conversions; the SSE2 ones are used instead.
+    if (__builtin_cpu_supports("avx2")) {
+        sets.push_back({"AVX2", floatToS16Avx2, floatToS32Avx2, mixWithGainAvx2,
+                        mixWithEnvelopeAvx2, s16ToFloatAvx2, monoToStereoSse2, stereoToMonoSse2});
+    }
+#endif
+#if AULIB_NEON
+    sets.push_back({"NEON", floatToS16Neon, floatToS32Neon, mixWithGainNeon, mixWithEnvelopeNeon,
+                    s16ToFloatNeon, monoToStereoNeon, stereoToMonoNeon});
+#endif
+    return sets;
+}
+
+/* Convert float samples into integer samples.
+ */
+template <typename T>
+static void floatToInt(Uint8 dst[], const Buffer<float>& src) noexcept
+{
+    if constexpr (std::is_same<T, Sint16>::value) {
+        kernels().toS16(dst, src.get(), src.size());
+        return;
+    }
+    if constexpr (std::is_same<T, Sint32>::value) {
+        kernels().toS32(dst, src.get(), src.size());
+        return;
+    }
+    floatToIntScalar<T>(dst, src.get(), src.size());
+}
+
 /* Convert float samples to endian-swapped integer samples.
  */
 template <typename T>
@@ -112,6 +560,51 @@ void Aulib::floatToS32MSB(Uint8 dst[], const Buffer<float>& src) noexcept
     floatToMsbInt<Sint32>(dst, src);
 }
 
+void Aulib::mixWithGain(float dst[], const float src[], const int len, const float gainLeft,
+                        const float gainRight) noexcept
+{
+    kernels().mixWithGain(dst, src, len, gainLeft, gainRight);
+}
+
+void Aulib::mixWithEnvelope(float dst[], const float src[], const float env[], const int len,
+                            const float gainLeft, const float gainRight) noexcept
+{
+    kernels().mixWithEnvelope(dst, src, env, len, gainLeft, gainRight);
+}
+
+void Aulib::s16ToFloat(float dst[], const Sint16 src[], const int len) noexcept
+{
+    kernels().fromS16(dst, src, len);
+}
+
+void Aulib::monoToStereo(float buf[], const int len) noexcept
+{
+    if (len < 1 or not buf) {
+        return;
+    }
+#if AULIB_SSE2
+    monoToStereoSse2(buf, len / 2);
+#elif AULIB_NEON
+    monoToStereoNeon(buf, len / 2);
+#else
+    monoToStereoScalar(buf, len / 2);
+#endif
+}
+
+void Aulib::stereoToMono(float dst[], const float src[], const int srcLen) noexcept
+{
+    if (srcLen < 1 or not dst or not src) {
+        return;
+    }
+#if AULIB_SSE2
+    stereoToMonoSse2(dst, src, srcLen / 2);
+#elif AULIB_NEON
+    stereoToMonoNeon(dst, src, srcLen / 2);
+#else
+    stereoToMonoScalar(dst, src, srcLen / 2);
+#endif
+}
+
 static void floatToSwappedFloat(Uint8 dst[], const Buffer<float>& src) noexcept
 {
     for (const auto i : src) {
@@ -3,6 +3,7 @@
 
 #include "aulib_global.h"
 #include <SDL_stdinc.h>
+#include <vector>
 
 template <typename T>
 class Buffer;
@@ -20,6 +21,43 @@ AULIB_NO_EXPORT void floatToS32MSB(Uint8 dst[], const Buffer<float>& src) noexce
 AULIB_NO_EXPORT void floatToFloatLSB(Uint8 dst[], const Buffer<float>& src) noexcept;
 AULIB_NO_EXPORT void floatToFloatMSB(Uint8 dst[], const Buffer<float>& src) noexcept;
 
+/* Mixing and channel conversion. These use SIMD kernels where available, picked at runtime
+ * according to the CPU's features. The results are identical to the plain C++ versions.
+ */
+
+// Adds 'src' scaled by the given gains to 'dst'. Even samples use gainLeft and odd ones gainRight.
+AULIB_NO_EXPORT void mixWithGain(float dst[], const float src[], int len, float gainLeft,
+                                 float gainRight) noexcept;
+// Like mixWithGain(), but each sample is additionally scaled by the matching entry in 'env'.
+AULIB_NO_EXPORT void mixWithEnvelope(float dst[], const float src[], const float env[], int len,
+                                     float gainLeft, float gainRight) noexcept;
+// Converts native endian signed 16-bit samples to float.
+AULIB_NO_EXPORT void s16ToFloat(float dst[], const Sint16 src[], int len) noexcept;
+// Expands the mono samples in the first half of 'buf' in-place into 'len' stereo samples.
+AULIB_NO_EXPORT void monoToStereo(float buf[], int len) noexcept;
+// Averages 'srcLen' stereo samples from 'src' into srcLen/2 mono samples in 'dst'.
+AULIB_NO_EXPORT void stereoToMono(float dst[], const float src[], int srcLen) noexcept;
+
+/* One implementation of each of the SIMD accelerated kernels. Unlike the functions above,
+ * monoToStereo and stereoToMono take the amount of mono samples.
+ */
+struct SampleKernelSet final
+{
+    const char* name;
+    void (*floatToS16)(Uint8[], const float[], int) noexcept;
+    void (*floatToS32)(Uint8[], const float[], int) noexcept;
+    void (*mixWithGain)(float[], const float[], int, float, float) noexcept;
+    void (*mixWithEnvelope)(float[], const float[], const float[], int, float, float) noexcept;
+    void (*s16ToFloat)(float[], const Sint16[], int) noexcept;
+    void (*monoToStereo)(float[], int) noexcept;
+    void (*stereoToMono)(float[], const float[], int) noexcept;
+};
+
+/* All kernel sets the CPU supports, for checking the SIMD kernels against the scalar ones and for
+ * benchmarking them. The first one is always the scalar reference.
+ */
+AULIB_NO_EXPORT auto sampleKernelSets() -> std::vector<SampleKernelSet>;
+
 } // namespace Aulib
 
 /*
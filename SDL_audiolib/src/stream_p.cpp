@@ -4,25 +4,37 @@
 #include "Aulib/Decoder.h"
 #include "Aulib/Resampler.h"
 #include "Aulib/Stream.h"
+#include "SdlAudioLocker.h"
 #include "aulib_debug.h"
 #include "aulib_log.h"
 #include "missing.h"
+#include "sampleconv.h"
 #include <SDL_timer.h>
 #include <algorithm>
-#include <cmath>
-#include <mutex>
-#include <type_traits>
 
 void (*Aulib::Stream_priv::fSampleConverter)(Uint8[], const Buffer<float>& src) = nullptr;
 SDL_AudioSpec Aulib::Stream_priv::fAudioSpec;
 #if SDL_VERSION_ATLEAST(2, 0, 0)
 SDL_AudioDeviceID Aulib::Stream_priv::fDeviceId;
+std::recursive_mutex Aulib::Stream_priv::fDeviceMutex;
+thread_local bool Aulib::Stream_priv::fInCallback = false;
 #endif
-std::vector<Aulib::Stream*> Aulib::Stream_priv::fStreamList;
-SdlMutex Aulib::Stream_priv::fStreamListMutex;
+std::array<std::atomic<Aulib::Stream*>, Aulib::Stream_priv::fMaxStreams>
+    Aulib::Stream_priv::fStreamSlots{};
+std::atomic_int Aulib::Stream_priv::fDeviceUnderruns{0};
+Uint64 Aulib::Stream_priv::fLastCallbackTime = 0;
+std::atomic<Uint64> Aulib::Stream_priv::fDeviceFrames{0};
+bool Aulib::Stream_priv::fOffline = false;
+std::atomic_bool Aulib::Stream_priv::fCollectStats{false};
+std::atomic_int Aulib::Stream_priv::fStatsCallbacks{0};
+std::atomic<Uint64> Aulib::Stream_priv::fStatsCallbackTicks{0};
+std::atomic<Uint64> Aulib::Stream_priv::fStatsMaxCallbackTicks{0};
+std::atomic<Uint64> Aulib::Stream_priv::fStatsMaxLockTicks{0};
+std::array<std::atomic_int, 7> Aulib::Stream_priv::fStatsHistogram{};
 Buffer<float> Aulib::Stream_priv::fFinalMixBuf{0};
 Buffer<float> Aulib::Stream_priv::fStrmBuf{0};
 Buffer<float> Aulib::Stream_priv::fProcessorBuf{0};
+Buffer<float> Aulib::Stream_priv::fGainBuf{0};
 
 Aulib::Stream_priv::Stream_priv(Stream* pub, std::unique_ptr<Decoder> decoder,
                                 std::unique_ptr<Resampler> resampler, SDL_RWops* rwops,
@@ -30,7 +42,7 @@ Aulib::Stream_priv::Stream_priv(Stream* pub, std::unique_ptr<Decoder> decoder,
     : q(pub)
     , fRWops(rwops)
     , fCloseRw(closeRw)
-    , fDecoder(std::move(decoder))
+    , fDecoder(std::make_shared<LoopDecoder>(std::move(decoder)))
     , fResampler(std::move(resampler))
 {
     if (fResampler) {
@@ -40,84 +52,555 @@ Aulib::Stream_priv::Stream_priv(Stream* pub, std::unique_ptr<Decoder> decoder,
 
 Aulib::Stream_priv::~Stream_priv()
 {
+    fAheadQuit = true;
+    fJoinDecodeAhead();
     if (fCloseRw and fRWops) {
         SDL_RWclose(fRWops);
     }
 }
 
-auto Aulib::Stream_priv::fProcessFadeAndCheckIfFinished() -> bool
+// Volume changes are spread over this much time to avoid clicks.
+constexpr std::chrono::milliseconds volumeRampTime{10};
+
+// Fades follow a cubic curve, which we sample once into a table and then interpolate.
+constexpr int fadeCurveSteps = 256;
+
+static auto fadeCurve(const float pos) -> float
+{
+    static const auto table = [] {
+        std::array<float, fadeCurveSteps + 1> curve{};
+        for (int i = 0; i <= fadeCurveSteps; ++i) {
+            const float x = static_cast<float>(i) / fadeCurveSteps;
+            curve[i] = x * x * x;
+        }
+        return curve;
+    }();
+
+    const float idx = std::min(std::max(pos, 0.f), 1.f) * fadeCurveSteps;
+    const int i = std::min(static_cast<int>(idx), fadeCurveSteps - 1);
+    return table[i] + (table[i + 1] - table[i]) * (idx - i);
+}
+
+static auto durationToFrames(const std::chrono::milliseconds duration, const int rate) -> Sint64
+{
+    return static_cast<Sint64>(duration.count()) * rate / 1000;
+}
+
+auto Aulib::Stream_priv::fVolumeAt(const Uint64 frame) const -> float
+{
+    const Sint64 rampLen = durationToFrames(volumeRampTime, fAudioSpec.freq);
+    const auto pos = static_cast<Sint64>(frame - fVolumeRampStartFrame);
+    if (pos >= rampLen) {
+        return fVolume;
+    }
+    if (pos <= 0) {
+        return fVolumeRampStart;
+    }
+    return fVolumeRampStart
+           + (fVolume - fVolumeRampStart) * static_cast<float>(pos) / static_cast<float>(rampLen);
+}
+
+auto Aulib::Stream_priv::fFadeAt(const Uint64 frame) const -> float
+{
+    if (fFadingIn) {
+        const Sint64 len = durationToFrames(fFadeInDuration, fAudioSpec.freq);
+        const auto pos = static_cast<Sint64>(frame - fFadeInStartFrame);
+        return len > 0 ? fadeCurve(static_cast<float>(pos) / len) : 1.f;
+    }
+    if (fFadingOut) {
+        const Sint64 len = durationToFrames(fFadeOutDuration, fAudioSpec.freq);
+        const auto pos = static_cast<Sint64>(frame - fFadeOutStartFrame);
+        return len > 0 ? fadeCurve(1.f - static_cast<float>(pos) / len) : 0.f;
+    }
+    return fInternalVolume;
+}
+
+/* Works out the stream's gain for 'frames' frames starting at device frame 'startFrame', including
+ * volume ramps and fades, times 'gain'. If it changes within that range, the gain of each sample
+ * is written to 'env' and true is returned. Otherwise, 'gain' is multiplied by the constant gain.
+ */
+auto Aulib::Stream_priv::fComputeGain(const Uint64 startFrame, const int frames, float env[],
+                                      float& gain) const -> bool
 {
-    static_assert(std::is_same<decltype(fFadeInDuration), std::chrono::milliseconds>::value, "");
-    static_assert(std::is_same<decltype(fFadeOutDuration), std::chrono::milliseconds>::value, "");
+    const Uint64 rampEnd =
+        fVolumeRampStartFrame + durationToFrames(volumeRampTime, fAudioSpec.freq);
+    if (not fFadingIn and not fFadingOut and startFrame >= rampEnd) {
+        gain *= fVolume * fInternalVolume;
+        return false;
+    }
+
+    const int channels = fAudioSpec.channels;
+    for (int i = 0; i < frames; ++i) {
+        const Uint64 frame = startFrame + i;
+        std::fill_n(env + i * channels, channels, fVolumeAt(frame) * fFadeAt(frame) * gain);
+    }
+    return true;
+}
 
+/* Ends fades that are over by 'endFrame'. When a fade-out ends, the stream is either stopped or
+ * paused. Returns true if it was stopped.
+ */
+auto Aulib::Stream_priv::fProcessFadeAndCheckIfFinished(const Uint64 endFrame) -> bool
+{
     if (fFadingIn) {
-        Sint64 now = SDL_GetTicks();
-        Sint64 curPos = now - fFadeInStartTick;
-        if (curPos >= fFadeInDuration.count()) {
+        if (endFrame >= fFadeInStartFrame + durationToFrames(fFadeInDuration, fAudioSpec.freq)) {
             fInternalVolume = 1.f;
             fFadingIn = false;
-            return false;
         }
-        fInternalVolume =
-            std::pow(static_cast<float>(now - fFadeInStartTick) / fFadeInDuration.count(), 3.f);
     } else if (fFadingOut) {
-        Sint64 now = SDL_GetTicks();
-        Sint64 curPos = now - fFadeOutStartTick;
-        if (curPos >= fFadeOutDuration.count()) {
+        if (endFrame >= fFadeOutStartFrame + durationToFrames(fFadeOutDuration, fAudioSpec.freq)) {
             fInternalVolume = 0.f;
-            fFadingIn = false;
+            fFadingOut = false;
             if (fStopAfterFade) {
                 fStopAfterFade = false;
                 fStop();
                 return true;
             }
             fIsPaused = true;
-            return false;
         }
-        fInternalVolume = std::pow(
-            -static_cast<float>(now - fFadeOutStartTick) / fFadeOutDuration.count() + 1.f, 3.f);
     }
     return false;
 }
 
+/* Runs the processors over 'len' samples at 'offset' in fStrmBuf and returns where the result
+ * ended up. Out of place processors alternate between fStrmBuf and fProcessorBuf, so nothing gets
+ * copied. Pure gain processors are not run; their gain is multiplied into 'gain' for the mix to
+ * apply, unless a processor that isn't one follows them.
+ */
+auto Aulib::Stream_priv::fRunProcessors(const int offset, const int len, float& gain)
+    -> const float*
+{
+    float* cur = fStrmBuf.get() + offset;
+    float* spare = fProcessorBuf.get() + offset;
+    float pending_gain = 1.f;
+
+    for (const auto& proc : processors) {
+        if (const auto proc_gain = proc->pureGain()) {
+            pending_gain *= *proc_gain;
+            continue;
+        }
+        // We can't know what the processor does with the gain, so it needs to be applied first.
+        if (pending_gain != 1.f) {
+            std::transform(cur, cur + len, cur,
+                           [pending_gain](const float sample) { return sample * pending_gain; });
+            pending_gain = 1.f;
+        }
+        if (proc->canProcessInPlace()) {
+            proc->process(cur, cur, len);
+        } else {
+            proc->process(spare, cur, len);
+            std::swap(cur, spare);
+        }
+    }
+    gain *= pending_gain;
+    return cur;
+}
+
 void Aulib::Stream_priv::fStop()
 {
+    fReleaseSlot();
+    if (fAheadThread.joinable()) {
+        // We might be running in the audio callback, so we can't wait for the thread here. It
+        // rewinds the decoder itself before it exits.
+        fAheadQuit = true;
+        fAheadCond.notify_one();
+    } else {
+        fDecoder->rewind();
+    }
+    fIsPlaying = false;
+}
+
+auto Aulib::Stream_priv::fClaimSlot(Stream* stream) -> bool
+{
+    AM_debugAssert(fSlot < 0);
+
+    for (int i = 0; i < fMaxStreams; ++i) {
+        Stream* expected = nullptr;
+        if (fStreamSlots[i].compare_exchange_strong(expected, stream)) {
+            fSlot = i;
+            return true;
+        }
+    }
+    SDL_SetError("Too many streams playing at the same time (maximum is %d).", fMaxStreams);
+    return false;
+}
+
+void Aulib::Stream_priv::fReleaseSlot()
+{
+    if (fSlot < 0) {
+        return;
+    }
+    fStreamSlots[fSlot].store(nullptr);
+    fSlot = -1;
+}
+
+/* Starts playback at the given device frame, or as soon as possible if there is none. Everything
+ * that can take a while (waiting for an earlier decode-ahead thread, setting up the loop, starting
+ * a new thread) is done before the device gets locked. The stream isn't playing yet, so the audio
+ * callback doesn't look at any of it.
+ */
+auto Aulib::Stream_priv::fPlay(Stream* stream, const std::optional<Uint64> frame,
+                               const int iterations, const std::chrono::microseconds fadeTime)
+    -> bool
+{
+    if (not stream->open()) {
+        return false;
+    }
+    {
+        SdlAudioLocker locker;
+        if (fIsPlaying) {
+            return true;
+        }
+    }
+
+    // A decode-ahead thread from an earlier play() might still be winding down.
+    fJoinDecodeAhead();
     {
-        std::lock_guard<SdlMutex> lock(fStreamListMutex);
-        fStreamList.erase(std::remove(fStreamList.begin(), fStreamList.end(), this->q),
-                          fStreamList.end());
+        auto decoderLock = fLockDecoder();
+        fDecoder->setLoop(iterations == 0 ? -1 : std::max(0, iterations - 1), fLoopStart,
+                          fLoopEnd);
+    }
+    fStartDecodeAhead();
+
+    SdlAudioLocker locker;
+    const Uint64 start_frame = frame ? *frame : fPlayStartFrame();
+    fCurrentIteration = 0;
+    fWantedIterations = iterations;
+    fStartFrame = start_frame;
+    fVolumeRampStart = fVolume;
+    fVolumeRampStartFrame = 0;
+    if (fadeTime.count() > 0) {
+        fInternalVolume = 0.f;
+        fFadingIn = true;
+        fFadingOut = false;
+        fFadeInDuration = std::chrono::duration_cast<std::chrono::milliseconds>(fadeTime);
+        fFadeInStartFrame = start_frame;
+    } else {
+        fInternalVolume = 1.f;
+        fFadingIn = false;
+    }
+    fUnderruns = 0;
+    if (not fClaimSlot(stream)) {
+        locker.unlock();
+        fAheadQuit = true;
+        fJoinDecodeAhead();
+        return false;
+    }
+    fIsPlaying = true;
+    return true;
+}
+
+// Must not be called with the audio device locked, since it waits for the old thread and creates
+// a new one. The callback only sees the new ring once the stream is playing.
+void Aulib::Stream_priv::fStartDecodeAhead()
+{
+    fJoinDecodeAhead();
+    // Offline rendering waits for decoding anyway, and this keeps its output independent of how
+    // fast the thread happens to run.
+    if (fAheadLength.count() <= 0 or fOffline) {
+        std::unique_ptr<RingBuffer<float>> old_ring;
+        SdlAudioLocker locker;
+        std::swap(fAheadRing, old_ring);
+        return;
+    }
+
+    const int channels = fAudioSpec.channels;
+    const auto msToSamples = [channels](const std::chrono::milliseconds ms) {
+        return static_cast<int>(ms.count() * fAudioSpec.freq / 1000) * channels;
+    };
+    // The ring needs to hold at least two periods, otherwise the thread can never stay ahead.
+    const int min_len = std::max(1024, fAudioSpec.samples * 2) * channels;
+    const int len = std::max(msToSamples(fAheadLength), min_len);
+    if (not fAheadRing or fAheadRing->capacity() < len) {
+        // Allocate, and free the old ring, without holding the lock.
+        auto ring = std::make_unique<RingBuffer<float>>(len);
+        SdlAudioLocker locker;
+        std::swap(fAheadRing, ring);
+    } else {
+        fAheadRing->clear();
     }
+    fAheadPrefillSamples = std::min(msToSamples(fAheadPrefill), fAheadRing->capacity());
+    fAheadPrefilling = true;
+    fAheadQuit = false;
+    fAheadDone = false;
+    fAheadLoops = 0;
+    fAheadThread = std::thread(&Stream_priv::fDecodeAheadLoop, this, fGovernLoad);
+}
+
+void Aulib::Stream_priv::fJoinDecodeAhead()
+{
+    if (not fAheadThread.joinable()) {
+        return;
+    }
+    fAheadCond.notify_one();
+    fAheadThread.join();
+}
+
+/* The load governor measures the time it takes to decode this much audio at a time. When decoding
+ * took more than the high load fraction of it in enough windows in a row, the decoder is asked to
+ * get cheaper. Changing quality can be audible (OPL emulation cuts off the playing notes), so a
+ * single slow window, like one with a loop point in it, isn't enough. After enough windows in a
+ * row below the low load, it's asked to go back up. A step usually halves or doubles the load, so
+ * the two limits are far enough apart to not make it go back and forth.
+ */
+constexpr int governorWindowMs = 1000;
+constexpr double governorHighLoad = 0.6;
+constexpr double governorLowLoad = 0.2;
+constexpr int governorReduceWindows = 2;
+constexpr int governorRestoreWindows = 10;
+
+void Aulib::Stream_priv::fDecodeAheadLoop(const bool governLoad)
+{
+    const int channels = fAudioSpec.channels;
+    const int chunk_len = std::max(512, static_cast<int>(fAudioSpec.samples)) * channels;
+    const auto wait_time = std::chrono::milliseconds(
+        std::max(1, chunk_len / channels * 1000 / fAudioSpec.freq / 2));
+    Buffer<float> buf(chunk_len);
+
+    const int window_frames = fAudioSpec.freq * governorWindowMs / 1000;
+    Uint64 window_ticks = 0;
+    int window_pos = 0;
+    int busy_windows = 0;
+    int quiet_windows = 0;
+
+    std::unique_lock<std::mutex> lock(fAheadMutex);
+    while (not fAheadQuit) {
+        int len = std::min(chunk_len, fAheadRing->writeAvailable());
+        len -= len % channels;
+        // Don't wake up for tiny amounts of free space.
+        if (len < chunk_len / 4) {
+            fAheadCond.wait_for(lock, wait_time);
+            continue;
+        }
+
+        const Uint64 start_ticks = SDL_GetPerformanceCounter();
+        fDecoder->setTimed(fCollectStats);
+        // We have the ring to cover for it, so waiting for a loop seek beats inserting silence.
+        fDecoder->setMayWait(true);
+        int pos = 0;
+        if (fResampler) {
+            pos = fResampler->resample(buf.get(), len);
+        } else {
+            bool callAgain = false;
+            do {
+                callAgain = false;
+                pos += fDecoder->decode(buf.get() + pos, len - pos, callAgain);
+            } while (pos < len and callAgain);
+        }
+        // Waiting for the loop seek isn't work we could make cheaper.
+        const Uint64 elapsed_ticks = SDL_GetPerformanceCounter() - start_ticks;
+        const Uint64 decode_ticks = elapsed_ticks - std::min(elapsed_ticks,
+                                                             fDecoder->takeWaitTicks());
+        fAheadRing->push(buf.get(), pos);
+        fAheadLoops += fDecoder->takeLoopCount();
+        fAddDecodeTime(decode_ticks);
+
+        if (governLoad) {
+            window_ticks += decode_ticks;
+            window_pos += pos / channels;
+            if (window_pos >= window_frames) {
+                const double load = static_cast<double>(window_ticks) * fAudioSpec.freq
+                                    / SDL_GetPerformanceFrequency() / window_pos;
+                if (load > governorHighLoad) {
+                    if (++busy_windows >= governorReduceWindows) {
+                        if (fDecoder->reduceLoad()) {
+                            aulib::log::debugLn("Decoding load {:.2f}, reduced decoder quality.",
+                                                load);
+                        }
+                        busy_windows = 0;
+                    }
+                    quiet_windows = 0;
+                } else if (load < governorLowLoad
+                           and ++quiet_windows >= governorRestoreWindows) {
+                    if (fDecoder->restoreLoad()) {
+                        aulib::log::debugLn("Decoding load {:.2f}, raised decoder quality.", load);
+                    }
+                    busy_windows = 0;
+                    quiet_windows = 0;
+                } else {
+                    busy_windows = 0;
+                    if (load >= governorLowLoad) {
+                        quiet_windows = 0;
+                    }
+                }
+                window_ticks = 0;
+                window_pos = 0;
+            }
+        }
+
+        // The decoder does the looping, so running out means we played the last iteration.
+        if (pos < len) {
+            fDecoder->rewind();
+            fAheadDone = true;
+            return;
+        }
+    }
+    // Leave the decoder at the start for the next time we play.
     fDecoder->rewind();
-    fIsPlaying = false;
+}
+
+auto Aulib::Stream_priv::fReadAhead(float dst[], const int len, bool& finished) -> int
+{
+    // Check this before looking at the ring, so that we don't miss audio that was pushed right
+    // before the thread finished.
+    const bool done = fAheadDone.load();
+
+    finished = false;
+    if (fAheadPrefilling) {
+        if (not done and fAheadRing->readAvailable() < fAheadPrefillSamples) {
+            return 0;
+        }
+        fAheadPrefilling = false;
+    }
+
+    const int read = fAheadRing->pop(dst, len);
+    if (fCollectStats.load(std::memory_order_relaxed)) {
+        const int fill = static_cast<int>(static_cast<Sint64>(fAheadRing->readAvailable()) * 100
+                                          / fAheadRing->capacity());
+        const int min_fill = fMinAheadFill.load(std::memory_order_relaxed);
+        if (min_fill < 0 or fill < min_fill) {
+            fMinAheadFill.store(fill, std::memory_order_relaxed);
+        }
+    }
+    if (read < len) {
+        if (done) {
+            finished = fAheadRing->readAvailable() == 0;
+        } else {
+            ++fUnderruns;
+        }
+    }
+    return read;
+}
+
+auto Aulib::Stream_priv::fLockDecoder() -> std::unique_lock<std::mutex>
+{
+    return std::unique_lock<std::mutex>(fAheadMutex);
+}
+
+/* Without decode-ahead, the audio callback uses the decoder directly, so it has to be locked out
+ * while someone else uses it. With decode-ahead, the callback only reads the ring and holding the
+ * decoder lock is enough. That way the callback never waits for a decode chunk to finish. Call
+ * this after fLockDecoder().
+ */
+void Aulib::Stream_priv::fLockCallbackDecoding(std::optional<SdlAudioLocker>& locker) const
+{
+    if (not fAheadRing) {
+        locker.emplace();
+    }
+}
+
+// Drops audio that was decoded ahead. The decoder must be locked.
+void Aulib::Stream_priv::fClearAheadRing()
+{
+    if (fAheadRing) {
+        SdlAudioLocker locker;
+        fAheadRing->clear();
+    }
+}
+
+// Splits the time a decode took into the part spent in the decoder and the part spent in the
+// resampler. Called after decoding with the decoder timed.
+void Aulib::Stream_priv::fAddDecodeTime(const Uint64 ticks)
+{
+    const Uint64 decoder_ticks = std::min(ticks, fDecoder->takeDecodeTicks());
+    if (not fCollectStats.load(std::memory_order_relaxed)) {
+        return;
+    }
+    if (fResampler) {
+        fDecodeTicks.fetch_add(decoder_ticks, std::memory_order_relaxed);
+        fResampleTicks.fetch_add(ticks - decoder_ticks, std::memory_order_relaxed);
+    } else {
+        fDecodeTicks.fetch_add(ticks, std::memory_order_relaxed);
+    }
+}
+
+auto Aulib::Stream_priv::fTicksToTime(const Uint64 ticks) -> std::chrono::microseconds
+{
+    return std::chrono::microseconds(
+        static_cast<Sint64>(static_cast<double>(ticks) * 1e6 / SDL_GetPerformanceFrequency()));
+}
+
+void Aulib::Stream_priv::fRaiseMax(std::atomic<Uint64>& max, const Uint64 value)
+{
+    Uint64 cur = max.load(std::memory_order_relaxed);
+    while (value > cur and not max.compare_exchange_weak(cur, value, std::memory_order_relaxed)) {
+    }
+}
+
+// Where the callback histogram buckets end, in 16ths of the callback period.
+constexpr std::array<Uint64, 6> statsBucketEnds{1, 2, 4, 8, 12, 16};
+
+void Aulib::Stream_priv::fRecordCallbackTime(const Uint64 ticks, const Uint64 periodTicks)
+{
+    fStatsCallbacks.fetch_add(1, std::memory_order_relaxed);
+    fStatsCallbackTicks.fetch_add(ticks, std::memory_order_relaxed);
+    fRaiseMax(fStatsMaxCallbackTicks, ticks);
+
+    const Uint64 sixteenths = periodTicks > 0 ? ticks * 16 / periodTicks : statsBucketEnds.back();
+    const auto bucket =
+        std::upper_bound(statsBucketEnds.begin(), statsBucketEnds.end(), sixteenths)
+        - statsBucketEnds.begin();
+    fStatsHistogram[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+/* The device frame a stream that is started right now should start at. This is one period after
+ * the current position of the device, which we estimate from the time that passed since the last
+ * callback. So no matter when it happens relative to the callback, there's always the same delay
+ * between starting a stream and its first sample being heard.
+ */
+auto Aulib::Stream_priv::fPlayStartFrame() -> Uint64
+{
+    const Uint64 frame = fDeviceFrames;
+    if (fLastCallbackTime == 0) {
+        return frame;
+    }
+    const Uint64 elapsed = (SDL_GetPerformanceCounter() - fLastCallbackTime) * fAudioSpec.freq
+                           / SDL_GetPerformanceFrequency();
+    return frame + std::min<Uint64>(elapsed, fAudioSpec.samples);
 }
 
 void Aulib::Stream_priv::fSdlCallbackImpl(void* /*unused*/, Uint8 out[], int outLen)
 {
     AM_debugAssert(Stream_priv::fSampleConverter);
+#if SDL_VERSION_ATLEAST(2, 0, 0)
+    // Finish and loop callbacks can use streams, which must not wait for fDeviceMutex here.
+    fInCallback = true;
+#endif
 
     const int out_len_samples = outLen / (SDL_AUDIO_BITSIZE(fAudioSpec.format) / 8);
     const int out_len_frames = out_len_samples / fAudioSpec.channels;
+    const Uint64 device_frame = fDeviceFrames;
+    const bool collect_stats = fCollectStats.load(std::memory_order_relaxed);
+
+    // The audio we produce lasts this many performance counter ticks. If we get called much later
+    // than that after the previous callback, the device already ran dry. Offline, nothing runs dry,
+    // and leaving fLastCallbackTime unset makes streams start exactly at the current device frame.
+    const Uint64 start_time = SDL_GetPerformanceCounter();
+    const Uint64 period_time = SDL_GetPerformanceFrequency() * out_len_frames / fAudioSpec.freq;
+    if (not fOffline) {
+        if (fLastCallbackTime != 0 and start_time - fLastCallbackTime > period_time * 2) {
+            ++fDeviceUnderruns;
+        }
+        fLastCallbackTime = start_time;
+    }
 
     if (fStrmBuf.size() != out_len_samples) {
         fFinalMixBuf.reset(out_len_samples);
         fStrmBuf.reset(out_len_samples);
         fProcessorBuf.reset(out_len_samples);
+        fGainBuf.reset(out_len_samples);
     }
 
     // Fill with silence.
     std::fill(fFinalMixBuf.begin(), fFinalMixBuf.end(), 0.f);
 
-    // Iterate over a copy of the original stream list, since we might want to
-    // modify the original as we go, removing streams that have stopped.
-    const std::vector<Stream*> streamList = [] {
-        std::lock_guard<SdlMutex> lock(fStreamListMutex);
-        return fStreamList;
-    }();
-
-    const int now_tick = SDL_GetTicks();
-    const int wanted_ticks = out_len_frames * 1000 / fAudioSpec.freq;
-
-    for (const auto stream : streamList) {
+    // Streams that stop while we're mixing only clear their own slot, so we can walk the slots
+    // directly without taking a copy.
+    for (auto& slot : fStreamSlots) {
+        Stream* const stream = slot.load(std::memory_order_acquire);
+        if (stream == nullptr) {
+            continue;
+        }
         if (stream->d->fWantedIterations != 0
             and stream->d->fCurrentIteration >= stream->d->fWantedIterations) {
             continue;
@@ -126,26 +609,43 @@ void Aulib::Stream_priv::fSdlCallbackImpl(void* /*unused*/, Uint8 out[], int out
             continue;
         }
 
-        const int ticks_since_play_start = now_tick - stream->d->fPlaybackStartTick;
-        if (ticks_since_play_start <= 0) {
+        // Streams scheduled to start during this period begin part way into it.
+        if (stream->d->fStartFrame >= device_frame + out_len_frames) {
             continue;
         }
+        const int out_offset =
+            stream->d->fStartFrame > device_frame
+                ? static_cast<int>(stream->d->fStartFrame - device_frame) * fAudioSpec.channels
+                : 0;
 
         bool has_finished = false;
         bool has_looped = false;
-        const int out_offset = [&] {
-            if (!stream->d->fStarting || ticks_since_play_start >= wanted_ticks) {
-                return 0;
+        int cur_pos = out_offset;
+
+        if (stream->d->fAheadRing) {
+            cur_pos += stream->d->fReadAhead(fStrmBuf.get() + cur_pos, out_len_samples - cur_pos,
+                                             has_finished);
+            if (has_finished) {
+                stream->d->fIsPlaying = false;
+                stream->d->fReleaseSlot();
             }
+            has_looped = stream->d->fAheadLoops.exchange(0) > 0;
+        }
 
-            const int out_offset_ticks = wanted_ticks - ticks_since_play_start;
-            const int offset = out_offset_ticks * fAudioSpec.channels * fAudioSpec.freq / 1000;
-            return offset - (offset % fAudioSpec.channels);
-        }();
-        int cur_pos = out_offset;
-        stream->d->fStarting = false;
+        // With stats enabled, each stage's time is measured from the end of the previous one.
+        Uint64 stage_ticks = collect_stats ? SDL_GetPerformanceCounter() : 0;
+        const auto lap = [&stage_ticks] {
+            const Uint64 now = SDL_GetPerformanceCounter();
+            const Uint64 elapsed = now - stage_ticks;
+            stage_ticks = now;
+            return elapsed;
+        };
 
-        while (cur_pos < out_len_samples) {
+        if (not stream->d->fAheadRing) {
+            stream->d->fDecoder->setTimed(collect_stats);
+            stream->d->fDecoder->setMayWait(false);
+        }
+        while (cur_pos < out_len_samples and not stream->d->fAheadRing) {
             if (stream->d->fResampler) {
                 cur_pos += stream->d->fResampler->resample(fStrmBuf.get() + cur_pos,
                                                            out_len_samples - cur_pos);
@@ -157,36 +657,41 @@ void Aulib::Stream_priv::fSdlCallbackImpl(void* /*unused*/, Uint8 out[], int out
                                                            out_len_samples - cur_pos, callAgain);
                 } while (cur_pos < out_len_samples and callAgain);
             }
-            for (const auto& proc : stream->d->processors) {
-                const int len = cur_pos - out_offset;
-                proc->process(fProcessorBuf.get() + out_offset, fStrmBuf.get() + out_offset, len);
-                std::memcpy(fStrmBuf.get() + out_offset, fProcessorBuf.get() + out_offset,
-                            len * sizeof(*fStrmBuf.get()));
+            if (const int loops = stream->d->fDecoder->takeLoopCount(); loops > 0) {
+                stream->d->fCurrentIteration += loops;
+                has_looped = true;
             }
+            stream->d->fUnderruns += stream->d->fDecoder->takeUnderruns();
+            // The decoder does the looping, so running out means we played the last iteration.
             if (cur_pos < out_len_samples) {
                 stream->d->fDecoder->rewind();
-                if (stream->d->fWantedIterations != 0) {
-                    ++stream->d->fCurrentIteration;
-                    if (stream->d->fCurrentIteration >= stream->d->fWantedIterations) {
-                        stream->d->fIsPlaying = false;
-                        {
-                            std::lock_guard<SdlMutex> lock(fStreamListMutex);
-                            fStreamList.erase(
-                                std::remove(fStreamList.begin(), fStreamList.end(), stream),
-                                fStreamList.end());
-                        }
-                        has_finished = true;
-                        break;
-                    }
-                    has_looped = true;
-                }
+                stream->d->fCurrentIteration = stream->d->fWantedIterations;
+                stream->d->fIsPlaying = false;
+                stream->d->fReleaseSlot();
+                has_finished = true;
+                break;
             }
         }
+        if (collect_stats and not stream->d->fAheadRing) {
+            stream->d->fAddDecodeTime(lap());
+        }
+
+        float gain = 1.f;
+        const float* const strm_samples =
+            stream->d->fRunProcessors(out_offset, cur_pos - out_offset, gain);
+        if (collect_stats) {
+            stream->d->fProcessTicks.fetch_add(lap(), std::memory_order_relaxed);
+        }
 
-        has_finished |= stream->d->fProcessFadeAndCheckIfFinished();
+        const Uint64 first_frame = device_frame + out_offset / fAudioSpec.channels;
+        const bool use_envelope = stream->d->fComputeGain(
+            first_frame, (cur_pos - out_offset) / fAudioSpec.channels, fGainBuf.get(), gain);
+        has_finished |=
+            stream->d->fProcessFadeAndCheckIfFinished(device_frame + out_len_frames);
 
-        float volumeLeft = stream->d->fVolume * stream->d->fInternalVolume;
-        float volumeRight = stream->d->fVolume * stream->d->fInternalVolume;
+        // With an envelope, the gain is already in there and we only need to apply panning.
+        float volumeLeft = use_envelope ? 1.f : gain;
+        float volumeRight = volumeLeft;
 
         if (fAudioSpec.channels > 1) {
             if (stream->d->fStereoPos < 0.f) {
@@ -198,22 +703,18 @@ void Aulib::Stream_priv::fSdlCallbackImpl(void* /*unused*/, Uint8 out[], int out
 
         // Avoid mixing on zero volume.
         if (not stream->d->fIsMuted and (volumeLeft > 0.f or volumeRight > 0.f)) {
-            // Avoid scaling operation when volume is 1.
-            if (fAudioSpec.channels > 1 and (volumeLeft != 1.f or volumeRight != 1.f)) {
-                for (int i = out_offset; i < cur_pos; i += 2) {
-                    fFinalMixBuf[i] += fStrmBuf[i] * volumeLeft;
-                    fFinalMixBuf[i + 1] += fStrmBuf[i + 1] * volumeRight;
-                }
-            } else if (volumeLeft != 1.f) {
-                for (int i = out_offset; i < cur_pos; ++i) {
-                    fFinalMixBuf[i] += fStrmBuf[i] * volumeLeft;
-                }
+            const float gain_right = fAudioSpec.channels > 1 ? volumeRight : volumeLeft;
+            if (use_envelope) {
+                mixWithEnvelope(fFinalMixBuf.get() + out_offset, strm_samples, fGainBuf.get(),
+                                cur_pos - out_offset, volumeLeft, gain_right);
             } else {
-                for (int i = out_offset; i < cur_pos; ++i) {
-                    fFinalMixBuf[i] += fStrmBuf[i];
-                }
+                mixWithGain(fFinalMixBuf.get() + out_offset, strm_samples, cur_pos - out_offset,
+                            volumeLeft, gain_right);
             }
         }
+        if (collect_stats) {
+            stream->d->fMixTicks.fetch_add(lap(), std::memory_order_relaxed);
+        }
 
         if (has_finished) {
             stream->invokeFinishCallback();
@@ -222,6 +723,18 @@ void Aulib::Stream_priv::fSdlCallbackImpl(void* /*unused*/, Uint8 out[], int out
         }
     }
     Stream_priv::fSampleConverter(out, fFinalMixBuf);
+    fDeviceFrames += out_len_frames;
+
+    const Uint64 callback_time = SDL_GetPerformanceCounter() - start_time;
+    if (not fOffline and callback_time > period_time) {
+        ++fDeviceUnderruns;
+    }
+    if (collect_stats) {
+        fRecordCallbackTime(callback_time, period_time);
+    }
+#if SDL_VERSION_ATLEAST(2, 0, 0)
+    fInCallback = false;
+#endif
 }
 
 /*
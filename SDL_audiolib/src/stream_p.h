@@ -4,16 +4,24 @@
 #include "Aulib/Processor.h"
 #include "Aulib/Stream.h"
 #include "Buffer.h"
-#include "SdlMutex.h"
+#include "LoopDecoder.h"
+#include "RingBuffer.h"
 #include "aulib.h"
 #include <SDL_audio.h>
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
 #include <vector>
 
+class SdlAudioLocker;
+
 namespace Aulib {
 
-class Decoder;
 class Resampler;
 
 struct Stream_priv final
@@ -27,20 +35,26 @@ struct Stream_priv final
     bool fIsOpen = false;
     SDL_RWops* fRWops;
     bool fCloseRw;
-    // Resamplers hold a reference to decoders, so we store it as a shared_ptr.
-    std::shared_ptr<Decoder> fDecoder;
+    // Resamplers hold a reference to decoders, so we store it as a shared_ptr. This wraps the
+    // decoder we were given and handles looping.
+    std::shared_ptr<LoopDecoder> fDecoder;
     std::unique_ptr<Resampler> fResampler;
     bool fIsPlaying = false;
     bool fIsPaused = false;
     float fVolume = 1.f;
+    // Volume changes ramp from this volume to fVolume, starting at the given device frame.
+    float fVolumeRampStart = 1.f;
+    Uint64 fVolumeRampStartFrame = 0;
     float fStereoPos = 0.f;
     float fInternalVolume = 1.f;
     int fCurrentIteration = 0;
     int fWantedIterations = 0;
-    int fPlaybackStartTick = 0;
-    int fFadeInStartTick = 0;
-    int fFadeOutStartTick = 0;
-    bool fStarting = false;
+    Sint64 fLoopStart = 0;
+    Sint64 fLoopEnd = -1;
+    // Device frame the stream starts playing at.
+    Uint64 fStartFrame = 0;
+    Uint64 fFadeInStartFrame = 0;
+    Uint64 fFadeOutStartFrame = 0;
     bool fFadingIn = false;
     bool fFadingOut = false;
     bool fStopAfterFade = false;
@@ -50,13 +64,69 @@ struct Stream_priv final
     bool fIsMuted = false;
     Stream::Callback fFinishCallback;
     Stream::Callback fLoopCallback;
+    // Index of our entry in fStreamSlots while playing, -1 otherwise.
+    int fSlot = -1;
+
+    // Decode-ahead state. While fAheadRing is set, fAheadThread is the only one decoding and the
+    // audio callback only reads from the ring. fAheadMutex is held by the thread while it uses the
+    // decoder, so other decoder access needs to lock it too.
+    std::chrono::milliseconds fAheadLength{};
+    std::chrono::milliseconds fAheadPrefill{};
+    std::unique_ptr<RingBuffer<float>> fAheadRing;
+    int fAheadPrefillSamples = 0;
+    bool fAheadPrefilling = false;
+    std::thread fAheadThread;
+    std::mutex fAheadMutex;
+    std::condition_variable fAheadCond;
+    std::atomic_bool fAheadQuit{false};
+    std::atomic_bool fAheadDone{false};
+    std::atomic_int fAheadLoops{0};
+    std::atomic_int fUnderruns{0};
+    // Whether the decode-ahead thread adjusts the decoder's quality to how long decoding takes.
+    bool fGovernLoad = false;
+
+    // Performance counters, in performance counter ticks. Updated by whoever decodes (the audio
+    // callback or the decode-ahead thread) while fCollectStats is set, and reset by takeStats().
+    std::atomic<Uint64> fDecodeTicks{0};
+    std::atomic<Uint64> fResampleTicks{0};
+    std::atomic<Uint64> fProcessTicks{0};
+    std::atomic<Uint64> fMixTicks{0};
+    // Lowest decode-ahead ring fill seen, in percent. -1 if nothing was measured.
+    std::atomic_int fMinAheadFill{-1};
 
     static ::SDL_AudioSpec fAudioSpec;
 #if SDL_VERSION_ATLEAST(2, 0, 0)
     static SDL_AudioDeviceID fDeviceId;
+    // Held by SdlAudioLocker and while the device is closed or replaced, so that the device can't
+    // go away while another thread has it locked. The audio callback doesn't need it, since the
+    // device isn't closed before the callback returns. It's recursive because lockers nest.
+    static std::recursive_mutex fDeviceMutex;
+    static thread_local bool fInCallback;
 #endif
-    static std::vector<Stream*> fStreamList;
-    static SdlMutex fStreamListMutex;
+    // Streams that are currently playing. The audio callback only reads these slots, so it never
+    // has to lock or allocate. Adding and removing a stream only touches its own slot.
+    static constexpr int fMaxStreams = 256;
+    static std::array<std::atomic<Stream*>, fMaxStreams> fStreamSlots;
+
+    // Device level underrun count, and the performance counter value of the last audio callback.
+    static std::atomic_int fDeviceUnderruns;
+    static Uint64 fLastCallbackTime;
+
+    // How many frames the audio callback has produced so far. This is the device's sample clock;
+    // stream starts, fades and volume ramps are timed against it.
+    static std::atomic<Uint64> fDeviceFrames;
+
+    // Mixer performance counters, only updated while fCollectStats is set. Times are in
+    // performance counter ticks. Histogram buckets are described in MixerStats.
+    static std::atomic_bool fCollectStats;
+    static std::atomic_int fStatsCallbacks;
+    static std::atomic<Uint64> fStatsCallbackTicks;
+    static std::atomic<Uint64> fStatsMaxCallbackTicks;
+    static std::atomic<Uint64> fStatsMaxLockTicks;
+    static std::array<std::atomic_int, 7> fStatsHistogram;
+
+    // Set when rendering offline. There's no device then, and the mixer only runs when asked to.
+    static bool fOffline;
 
     // This points to an appropriate converter for the current audio format.
     static void (*fSampleConverter)(Uint8[], const Buffer<float>& src);
@@ -65,9 +135,31 @@ struct Stream_priv final
     static Buffer<float> fFinalMixBuf;
     static Buffer<float> fStrmBuf;
     static Buffer<float> fProcessorBuf;
+    static Buffer<float> fGainBuf;
 
-    auto fProcessFadeAndCheckIfFinished() -> bool;
+    auto fVolumeAt(Uint64 frame) const -> float;
+    auto fFadeAt(Uint64 frame) const -> float;
+    auto fComputeGain(Uint64 startFrame, int frames, float env[], float& gain) const -> bool;
+    auto fProcessFadeAndCheckIfFinished(Uint64 endFrame) -> bool;
+    auto fRunProcessors(int offset, int len, float& gain) -> const float*;
     void fStop();
+    auto fClaimSlot(Stream* stream) -> bool;
+    void fReleaseSlot();
+    auto fPlay(Stream* stream, std::optional<Uint64> frame, int iterations,
+               std::chrono::microseconds fadeTime) -> bool;
+    void fStartDecodeAhead();
+    void fJoinDecodeAhead();
+    void fLockCallbackDecoding(std::optional<SdlAudioLocker>& locker) const;
+    void fClearAheadRing();
+    void fDecodeAheadLoop(bool governLoad);
+    auto fReadAhead(float dst[], int len, bool& finished) -> int;
+    auto fLockDecoder() -> std::unique_lock<std::mutex>;
+    void fAddDecodeTime(Uint64 ticks);
+
+    static auto fPlayStartFrame() -> Uint64;
+    static auto fTicksToTime(Uint64 ticks) -> std::chrono::microseconds;
+    static void fRaiseMax(std::atomic<Uint64>& max, Uint64 value);
+    static void fRecordCallbackTime(Uint64 ticks, Uint64 periodTicks);
 
     static void fSdlCallbackImpl(void* /*unused*/, Uint8 out[], int outLen);
 };
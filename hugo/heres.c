@@ -207,11 +207,18 @@ void PlaySample(void)
 
 	if (MEM(codeptr+1)==REPEAT_T) loop_flag = true, codeptr++;
 
+#if !defined (HUGOR)
 	hugo_stopsample();
+#endif
 
 	/* If a 0 parameter is passed, i.e. "sound 0" */
 	if (!GetResourceParameters(filename, resname))
 	{
+#if defined (HUGOR)
+		/* Hugor plays samples on several voices so that they can
+		   overlap, so only "sound 0" stops them */
+		hugo_stopsample();
+#endif
 		return;
 	}
 
@@ -72,6 +72,18 @@ equals(QT_MAJOR_VERSION, 5) {
         SOURCES += SDL_audiolib/src/DecoderAdlmidi.cpp
     }
 
+    samplerate {
+        PKGCONFIG += samplerate
+        DEFINES += USE_RESAMP_SRC=1
+        SOURCES += SDL_audiolib/src/ResamplerSrc.cpp
+    }
+
+    soxr {
+        PKGCONFIG += soxr
+        DEFINES += USE_RESAMP_SOXR=1
+        SOURCES += SDL_audiolib/src/ResamplerSox.cpp
+    }
+
     DEFINES += \
         AULIB_STATIC_DEFINE \
         FMT_HEADER_ONLY \
@@ -86,11 +98,15 @@ equals(QT_MAJOR_VERSION, 5) {
         $$files(SDL_audiolib/src/*.h) \
         $$files(SDL_audiolib/src/missing/*.h) \
         src/oplvolumebooster.h \
+        src/pcmdecoder.h \
+        src/resamplerfactory.h \
         src/rwopsbundle.h \
         src/synthfactory.h
 
     SOURCES += \
         src/oplvolumebooster.cc \
+        src/pcmdecoder.cc \
+        src/resamplerfactory.cc \
         src/rwopsbundle.c \
         src/soundaulib.cc \
         src/synthfactory.cc \
@@ -100,13 +116,29 @@ equals(QT_MAJOR_VERSION, 5) {
         SDL_audiolib/src/DecoderFluidsynth.cpp \
         SDL_audiolib/src/DecoderMpg123.cpp \
         SDL_audiolib/src/DecoderSndfile.cpp \
+        SDL_audiolib/src/LoopDecoder.cpp \
         SDL_audiolib/src/Processor.cpp \
         SDL_audiolib/src/Resampler.cpp \
+        SDL_audiolib/src/ResamplerSdl.cpp \
         SDL_audiolib/src/ResamplerSpeex.cpp \
         SDL_audiolib/src/Stream.cpp \
         SDL_audiolib/src/stream_p.cpp \
         SDL_audiolib/src/aulib.cpp \
         SDL_audiolib/src/sampleconv.cpp
+
+    # The sample conversion kernels must not use fused multiply-adds (see sampleconv.cpp). qmake
+    # has no per-file flags, so that file gets its own compiler.
+    *-g++*|*-clang* {
+        SOURCES -= SDL_audiolib/src/sampleconv.cpp
+        NOCONTRACT_SOURCES = SDL_audiolib/src/sampleconv.cpp
+        nocontract.name = nocontract
+        nocontract.input = NOCONTRACT_SOURCES
+        nocontract.dependency_type = TYPE_C
+        nocontract.variable_out = OBJECTS
+        nocontract.output = ${QMAKE_VAR_OBJECTS_DIR}${QMAKE_FILE_IN_BASE}$${first(QMAKE_EXT_OBJ)}
+        nocontract.commands = $${QMAKE_CXX} $(CXXFLAGS) -ffp-contract=off $(INCPATH) -c ${QMAKE_FILE_IN} -o ${QMAKE_FILE_OUT}
+        QMAKE_EXTRA_COMPILERS += nocontract
+    }
 } else {
     DEFINES += DISABLE_AUDIO
     SOURCES += src/soundnone.cc
@@ -204,6 +236,7 @@ HEADERS += \
     src/hmarginwidget.h \
     src/hscrollback.h \
     src/hugodefs.h \
+    src/inputqueue.h \
     src/kcolorbutton.h \
     src/settings.h \
     src/settingsoverrides.h \
@@ -211,6 +244,7 @@ HEADERS += \
     src/hugohandlers.h \
     src/hugorfile.h \
     src/opcodeparser.h \
+    src/picturecache.h \
     src/util.h \
     src/extcolors.h \
     \
@@ -226,6 +260,7 @@ SOURCES += \
     src/hmainwindow.cc \
     src/hmarginwidget.cc \
     src/hscrollback.cc \
+    src/inputqueue.cc \
     src/kcolorbutton.cc \
     src/main.cc \
     src/settings.cc \
@@ -233,6 +268,7 @@ SOURCES += \
     src/enginerunner.cc \
     src/hugohandlers.cc \
     src/opcodeparser.cc \
+    src/picturecache.cc \
     src/extcolors.cc \
     src/hugorfile.cc \
     src/util.cc \
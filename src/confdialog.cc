@@ -8,13 +8,17 @@
 #include <QPushButton>
 #include <QResource>
 #include <QSignalMapper>
+#include <QStandardItemModel>
 #include <QStyle>
+#include <algorithm>
+#include <array>
 #ifndef DISABLE_AUDIO
 #include "oplvolumebooster.h"
+#include "resamplerfactory.h"
 #include "synthfactory.h"
 #include <Aulib/DecoderAdlmidi.h>
 #include <Aulib/DecoderFluidsynth.h>
-#include <Aulib/ResamplerSpeex.h>
+#include <Aulib/Resampler.h>
 #include <Aulib/Stream.h>
 #include <SDL_rwops.h>
 #endif
@@ -32,6 +36,21 @@
 using namespace std::chrono_literals;
 #endif
 
+// Values for the entries of the sample rate and audio buffer size combo boxes.
+static constexpr std::array<int, 4> SAMPLE_RATES{22050, 44100, 48000, 96000};
+static constexpr std::array<int, 7> AUDIO_PERIODS{0, 256, 512, 1024, 2048, 4096, 8192};
+
+// Index of the combo box entry for 'value', or the entry for 'fallback' if there's none.
+template <std::size_t N>
+static int comboIndexOf(const std::array<int, N>& values, const int value, const int fallback)
+{
+    auto it = std::find(values.begin(), values.end(), value);
+    if (it == values.end()) {
+        it = std::find(values.begin(), values.end(), fallback);
+    }
+    return it - values.begin();
+}
+
 ConfDialog::ConfDialog(HMainWindow* parent)
     : QDialog(parent, Qt::WindowTitleHint | Qt::WindowSystemMenuHint | Qt::WindowCloseButtonHint)
     , ui_(std::make_unique<Ui::ConfDialog>())
@@ -82,6 +101,8 @@ ConfDialog::ConfDialog(HMainWindow* parent)
 #endif
 
     ui_->allowGraphicsCheckBox->setChecked(sett.enable_graphics);
+    ui_->pictureCacheSpinBox->setValue(sett.picture_cache_size);
+    ui_->prefetchPicturesCheckBox->setChecked(sett.prefetch_pictures);
 #ifdef DISABLE_VIDEO
     ui_->allowVideoCheckBox->setChecked(false);
     ui_->allowVideoCheckBox->setDisabled(true);
@@ -97,10 +118,60 @@ ConfDialog::ConfDialog(HMainWindow* parent)
     ui_->allowSoundEffectsCheckBox->setDisabled(true);
     ui_->allowMusicCheckBox->setDisabled(true);
     ui_->muteWhenMinimizedCheckBox->setDisabled(true);
+    ui_->audioOutputGroupBox->setDisabled(true);
+    ui_->sampleCacheLabel->setDisabled(true);
+    ui_->sampleCacheSpinBox->setDisabled(true);
+    ui_->maxCachedSampleLabel->setDisabled(true);
+    ui_->maxCachedSampleSpinBox->setDisabled(true);
+    ui_->resamplerGroupBox->setDisabled(true);
 #else
     ui_->allowSoundEffectsCheckBox->setChecked(sett.enable_sound_effects);
     ui_->allowMusicCheckBox->setChecked(sett.enable_music);
     ui_->muteWhenMinimizedCheckBox->setChecked(sett.mute_when_minimized);
+#endif
+    ui_->sampleCacheSpinBox->setValue(sett.sample_cache_size);
+    ui_->maxCachedSampleSpinBox->setValue(sett.max_cached_sample_size);
+    ui_->sampleRateComboBox->setCurrentIndex(
+        comboIndexOf(SAMPLE_RATES, sett.audio_sample_rate, 44100));
+    switch (sett.audio_format) {
+    case Settings::AudioFormat::Int16:
+        ui_->audioFormatComboBox->setCurrentIndex(0);
+        break;
+    case Settings::AudioFormat::Int32:
+        ui_->audioFormatComboBox->setCurrentIndex(1);
+        break;
+    case Settings::AudioFormat::Float32:
+        ui_->audioFormatComboBox->setCurrentIndex(2);
+        break;
+    }
+    ui_->audioChannelsComboBox->setCurrentIndex(sett.audio_channels == 1 ? 0 : 1);
+    ui_->audioPeriodComboBox->setCurrentIndex(comboIndexOf(AUDIO_PERIODS, sett.audio_period, 0));
+    // The resampler combo box entries are in the same order as the enum values.
+    ui_->musicResamplerComboBox->setCurrentIndex(static_cast<int>(sett.music_resampler));
+    ui_->musicResamplerQualityComboBox->setCurrentIndex(
+        static_cast<int>(sett.music_resampler_quality));
+    ui_->sampleResamplerComboBox->setCurrentIndex(static_cast<int>(sett.sample_resampler));
+    ui_->sampleResamplerQualityComboBox->setCurrentIndex(
+        static_cast<int>(sett.sample_resampler_quality));
+#ifndef DISABLE_AUDIO
+    for (auto* comboBox : {ui_->musicResamplerComboBox, ui_->sampleResamplerComboBox}) {
+        auto* model = qobject_cast<QStandardItemModel*>(comboBox->model());
+        for (int i = 0; i < comboBox->count(); ++i) {
+            model->item(i)->setEnabled(
+                isResamplerAvailable(static_cast<Settings::ResamplerType>(i)));
+        }
+    }
+    // The automatic resampler picks its own quality.
+    const auto connectResamplerQuality = [](QComboBox* typeBox, QComboBox* qualityBox) {
+        const auto update = [typeBox, qualityBox] {
+            qualityBox->setEnabled(typeBox->currentIndex()
+                                   != static_cast<int>(Settings::ResamplerType::Automatic));
+        };
+        update();
+        connect(typeBox, qOverload<int>(&QComboBox::currentIndexChanged), qualityBox, update);
+    };
+    connectResamplerQuality(ui_->musicResamplerComboBox, ui_->musicResamplerQualityComboBox);
+    connectResamplerQuality(ui_->sampleResamplerComboBox, ui_->sampleResamplerQualityComboBox);
 #endif
 #if defined(DISABLE_VIDEO) and defined(DISABLE_AUDIO)
     ui_->volumeLabel->setDisabled(true);
@@ -167,6 +238,7 @@ ConfDialog::ConfDialog(HMainWindow* parent)
         break;
     }
     ui_->cursorThicknessComboBox->setCurrentIndex(sett.cursor_thickness);
+    ui_->inputQueueSpinBox->setValue(sett.input_queue_size);
     ui_->cursorThicknessComboBox->setDisabled(sett.cursor_shape
                                               == Settings::TextCursorShape::Block);
     if (sett.start_fullscreen) {
@@ -247,8 +319,13 @@ void ConfDialog::makeInstantApply()
             &ConfDialog::applySettings);
     connect(ui_->cursorThicknessComboBox, qOverload<int>(&QComboBox::currentIndexChanged), this,
             &ConfDialog::applySettings);
+    connect(ui_->inputQueueSpinBox, qOverload<int>(&QSpinBox::valueChanged), this,
+            &ConfDialog::applySettings);
     connect(ui_->allowGraphicsCheckBox, &QCheckBox::toggled, this, &ConfDialog::applySettings);
     connect(ui_->allowVideoCheckBox, &QCheckBox::toggled, this, &ConfDialog::applySettings);
+    connect(ui_->pictureCacheSpinBox, qOverload<int>(&QSpinBox::valueChanged), this,
+            &ConfDialog::applySettings);
+    connect(ui_->prefetchPicturesCheckBox, &QCheckBox::toggled, this, &ConfDialog::applySettings);
     connect(ui_->allowSoundEffectsCheckBox, &QCheckBox::toggled, this, &ConfDialog::applySettings);
     connect(ui_->allowMusicCheckBox, &QCheckBox::toggled, this, &ConfDialog::applySettings);
     connect(ui_->muteWhenMinimizedCheckBox, &QCheckBox::toggled, this, &ConfDialog::applySettings);
@@ -258,6 +335,26 @@ void ConfDialog::makeInstantApply()
     connect(ui_->gainSpinBox, qOverload<double>(&QDoubleSpinBox::valueChanged), this,
             &ConfDialog::applySettings);
     connect(ui_->adlibRadioButton, &QRadioButton::toggled, this, &ConfDialog::applySettings);
+    connect(ui_->sampleCacheSpinBox, qOverload<int>(&QSpinBox::valueChanged), this,
+            &ConfDialog::applySettings);
+    connect(ui_->maxCachedSampleSpinBox, qOverload<int>(&QSpinBox::valueChanged), this,
+            &ConfDialog::applySettings);
+    connect(ui_->sampleRateComboBox, qOverload<int>(&QComboBox::currentIndexChanged), this,
+            &ConfDialog::applySettings);
+    connect(ui_->audioFormatComboBox, qOverload<int>(&QComboBox::currentIndexChanged), this,
+            &ConfDialog::applySettings);
+    connect(ui_->audioChannelsComboBox, qOverload<int>(&QComboBox::currentIndexChanged), this,
+            &ConfDialog::applySettings);
+    connect(ui_->audioPeriodComboBox, qOverload<int>(&QComboBox::currentIndexChanged), this,
+            &ConfDialog::applySettings);
+    connect(ui_->musicResamplerComboBox, qOverload<int>(&QComboBox::currentIndexChanged), this,
+            &ConfDialog::applySettings);
+    connect(ui_->musicResamplerQualityComboBox, qOverload<int>(&QComboBox::currentIndexChanged),
+            this, &ConfDialog::applySettings);
+    connect(ui_->sampleResamplerComboBox, qOverload<int>(&QComboBox::currentIndexChanged), this,
+            &ConfDialog::applySettings);
+    connect(ui_->sampleResamplerQualityComboBox, qOverload<int>(&QComboBox::currentIndexChanged),
+            this, &ConfDialog::applySettings);
     connect(ui_->overlayScrollbackCheckBox, &QCheckBox::toggled, this, &ConfDialog::applySettings);
     connect(ui_->scrollWheelCheckBox, &QCheckBox::toggled, this, &ConfDialog::applySettings);
     connect(ui_->mainTextColorButton, &KColorButton::changed, this, &ConfDialog::applySettings);
@@ -281,6 +378,8 @@ void ConfDialog::applySettings()
         sett.enable_video = ui_->allowVideoCheckBox->isChecked();
     }
 #endif
+    sett.picture_cache_size = ui_->pictureCacheSpinBox->value();
+    sett.prefetch_pictures = ui_->prefetchPicturesCheckBox->isChecked();
     sett.enable_sound_effects = ui_->allowSoundEffectsCheckBox->isChecked();
     sett.enable_music = ui_->allowMusicCheckBox->isChecked();
     sett.mute_when_minimized = ui_->muteWhenMinimizedCheckBox->isChecked();
@@ -290,6 +389,30 @@ void ConfDialog::applySettings()
         ui_->soundFontGroupBox->isChecked() and not sett.soundfont.isEmpty();
     sett.synth_gain = ui_->gainSpinBox->value();
     sett.use_adlmidi = ui_->adlibRadioButton->isChecked();
+    sett.sample_cache_size = ui_->sampleCacheSpinBox->value();
+    sett.max_cached_sample_size = ui_->maxCachedSampleSpinBox->value();
+    sett.audio_sample_rate = SAMPLE_RATES.at(ui_->sampleRateComboBox->currentIndex());
+    switch (ui_->audioFormatComboBox->currentIndex()) {
+    case 0:
+        sett.audio_format = Settings::AudioFormat::Int16;
+        break;
+    case 1:
+        sett.audio_format = Settings::AudioFormat::Int32;
+        break;
+    case 2:
+        sett.audio_format = Settings::AudioFormat::Float32;
+        break;
+    }
+    sett.audio_channels = ui_->audioChannelsComboBox->currentIndex() + 1;
+    sett.audio_period = AUDIO_PERIODS.at(ui_->audioPeriodComboBox->currentIndex());
+    sett.music_resampler =
+        static_cast<Settings::ResamplerType>(ui_->musicResamplerComboBox->currentIndex());
+    sett.music_resampler_quality =
+        static_cast<Settings::ResamplerQuality>(ui_->musicResamplerQualityComboBox->currentIndex());
+    sett.sample_resampler =
+        static_cast<Settings::ResamplerType>(ui_->sampleResamplerComboBox->currentIndex());
+    sett.sample_resampler_quality = static_cast<Settings::ResamplerQuality>(
+        ui_->sampleResamplerQualityComboBox->currentIndex());
     sett.main_bg_color = ui_->mainBgColorButton->color();
     sett.main_text_color = ui_->mainTextColorButton->color();
     sett.status_bg_color = ui_->bannerBgColorButton->color();
@@ -326,6 +449,7 @@ void ConfDialog::applySettings()
         break;
     }
     sett.cursor_thickness = ui_->cursorThicknessComboBox->currentIndex();
+    sett.input_queue_size = ui_->inputQueueSpinBox->value();
     sett.start_fullscreen = ui_->fullscreenRadioButton->isChecked();
     sett.start_windowed = ui_->windowRadioButton->isChecked();
 
@@ -389,7 +513,10 @@ void ConfDialog::playTestMidi()
 #if USE_DEC_ADLMIDI
     }
 #endif
-    auto resampler = std::make_unique<Aulib::ResamplerSpeex>();
+    auto resampler = makeResampler(
+        static_cast<Settings::ResamplerType>(ui_->musicResamplerComboBox->currentIndex()),
+        static_cast<Settings::ResamplerQuality>(ui_->musicResamplerQualityComboBox->currentIndex()),
+        ResamplerUse::Music);
     auto* rwops = SDL_RWFromConstMem(midiRes.data(), midiRes.size());
     midi_stream_ =
         std::make_unique<Aulib::Stream>(rwops, std::move(decoder), std::move(resampler), true);
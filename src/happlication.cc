@@ -27,6 +27,7 @@ extern "C" {
 #include "hmarginwidget.h"
 #include "hugodefs.h"
 #include "hugohandlers.h"
+#include "picturecache.h"
 #include "settings.h"
 #include "settingsoverrides.h"
 #include "util.h"
@@ -124,6 +125,8 @@ HApplication::HApplication(int& argc, char* argv[], const char* appName, const c
     // Apply the smart formatting setting.
     smartformatting = settings_.smart_formatting;
 
+    pictureCache().setMaxBytes(settings_.picture_cache_size * 1024LL * 1024LL);
+
     // Set our global pointer.
     hApp = this;
 
@@ -369,8 +372,11 @@ void HApplication::notifyPreferencesChange(const Settings& sett)
 
     // The fonts might have changed.
     hFrame->setFontType(currentfont);
+    hFrame->setInputQueueLimit(sett.input_queue_size);
     hMainWin->setScrollbackFont(sett.scrollback_font);
 
+    pictureCache().setMaxBytes(sett.picture_cache_size * 1024LL * 1024LL);
+
     display_needs_repaint = true;
 #ifndef DISABLE_AUDIO
     if (not sett.enable_music) {
@@ -382,6 +388,7 @@ void HApplication::notifyPreferencesChange(const Settings& sett)
     updateMusicVolume();
     updateSoundVolume();
     updateVideoVolume();
+    updateAudioPeriod();
 #endif
 #ifndef DISABLE_VIDEO
     if (not sett.enable_video) {
@@ -306,7 +306,7 @@ HUGO_FILE hugo_fopen(const char* path, const char* mode)
     if (handle == nullptr) {
         return nullptr;
     }
-    return new HugorFile(handle);
+    return new HugorFile(handle, path);
 }
 
 int hugo_fclose(HUGO_FILE file)
@@ -464,21 +464,17 @@ int hugo_getkey(void)
     }
     flushScrollbackBuffer();
 
-    QMutexLocker mLocker(waiterMutex);
-    if (not hugo_iskeywaiting()) {
-        hFrame->keypressAvailableWaitCond.wait(waiterMutex);
-    }
-    mLocker.unlock();
+    // Update the game screen before we wait for input.
+    hugo_iskeywaiting();
 
-    int key = hFrame->getNextKey();
-    if (key == 0) {
+    const auto& input = hFrame->getNextInput();
+    if (input.key == 0) {
         // It's a mouse click.
-        const QPoint& pos = hFrame->getNextClick();
-        display_pointer_x = (pos.x() - physical_windowleft) / FIXEDCHARWIDTH + 1;
-        display_pointer_y = (pos.y() - physical_windowtop) / FIXEDLINEHEIGHT + 1;
+        display_pointer_x = (input.click_pos.x() - physical_windowleft) / FIXEDCHARWIDTH + 1;
+        display_pointer_y = (input.click_pos.y() - physical_windowtop) / FIXEDLINEHEIGHT + 1;
         return 1;
     }
-    return key;
+    return input.key;
 }
 
 /* hugo_getline
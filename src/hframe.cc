@@ -10,6 +10,7 @@
 #include <QTextCodec>
 #include <QTimer>
 #include <QWindow>
+#include <algorithm>
 
 #include "happlication.h"
 extern "C" {
@@ -23,6 +24,10 @@ extern "C" {
 
 HFrame* hFrame = nullptr;
 
+// Dropped input is reported at most this often, so that typing into a full queue doesn't flood the
+// log.
+static constexpr qint64 DROPPED_INPUT_REPORT_INTERVAL_MS = 5000;
+
 static qreal dpr()
 {
     return hMainWin->windowHandle()->devicePixelRatio();
@@ -33,6 +38,7 @@ HFrame::HFrame(QWidget* parent)
     , cursor_height_(QFontMetrics(hApp->settings().prop_font).height())
     , blink_timer_(new QTimer(this))
     , minimize_timer_(new QTimer(this))
+    , resize_settle_timer_(new QTimer(this))
 {
     // We handle player input, so we need to accept focus.
     setFocusPolicy(Qt::WheelFocus);
@@ -47,10 +53,19 @@ HFrame::HFrame(QWidget* parent)
     minimize_timer_->setSingleShot(true);
     connect(minimize_timer_, &QTimer::timeout, this, &HFrame::handleFocusLost);
 
+    resize_settle_timer_->setSingleShot(true);
+    resize_settle_timer_->setInterval(100);
+    connect(resize_settle_timer_, &QTimer::timeout, this, [] {
+        HugoHandlers::settextmode();
+        display_needs_repaint = true;
+    });
+
     // Requesting scrollback simply triggers the scrollback window. Since focus is lost, subsequent
     // scrolling/paging events will work as expected.
     connect(this, &HFrame::requestScrollback, hMainWin, &HMainWindow::showScrollback);
 
+    input_queue_.setLimit(hApp->settings().input_queue_size);
+
     setAttribute(Qt::WA_InputMethodEnabled);
     setAttribute(Qt::WA_OpaquePaintEvent);
     hFrame = this;
@@ -58,20 +73,15 @@ HFrame::HFrame(QWidget* parent)
 
 void HFrame::enqueueKey(char key, QMouseEvent* e)
 {
-    QMutexLocker mKeyLocker(&key_queue_mutex_);
-    QMutexLocker mClickLocker(&click_queue_mutex_);
-    // Only allow one keypress or click in the queue. No reason to use a queue for that, but we
-    // might still want the possibilty to change this to allow multiple keys/clicks to queue up, if
-    // the need for that arises.
-    if (key_queue_.empty()) {
-        key_queue_.enqueue(key);
-        if (e != nullptr) {
-            click_queue_.append(e->pos());
-        }
+    if (input_queue_.push(key, e != nullptr ? e->pos() : QPoint())) {
+        return;
+    }
+    if (not dropped_input_report_timer_.isValid()
+        or dropped_input_report_timer_.elapsed() >= DROPPED_INPUT_REPORT_INTERVAL_MS) {
+        qWarning("Input queue full, %llu key presses and clicks dropped so far.",
+                 static_cast<unsigned long long>(droppedInputCount()));
+        dropped_input_report_timer_.start();
     }
-    mKeyLocker.unlock();
-    mClickLocker.unlock();
-    keypressAvailableWaitCond.wakeAll();
 }
 
 void HFrame::updateCursorShape()
@@ -180,17 +190,19 @@ void HFrame::paintEvent(QPaintEvent* e)
 
     // Draw our current input. We need to do this here, after the pixmap has already been painted,
     // so that the input gets painted on top. Otherwise, we could not erase text during editing.
-    QFont f(use_fixed_font_ ? hApp->settings().fixed_font : hApp->settings().prop_font);
-    f.setUnderline(use_underline_font_);
-    f.setItalic(use_italic_font_);
-    f.setBold(use_bold_font_);
-    QFontMetrics m(f);
-    p.setFont(f);
+    p.setFont(font_);
     if (input_mode_ == InputMode::Normal and not input_buf_.isEmpty()) {
+        syncInputOffsets();
+        // Only draw the input starting from the character that was repainted. We back off by one
+        // character in case the previous one overhangs (like with italics.)
+        const auto& it = std::upper_bound(input_offsets_.cbegin(), input_offsets_.cend(),
+                                          e->rect().left() - input_start_x_);
+        const int from = qMax(0, static_cast<int>(it - input_offsets_.cbegin()) - 2);
         p.setPen(hugoColorToQt(fg_color_));
         p.setBackgroundMode(Qt::OpaqueMode);
         p.setBackground(QBrush(hugoColorToQt(bg_color_)));
-        p.drawText(input_start_x_, input_start_y_ + m.ascent(), input_buf_);
+        p.drawText(input_start_x_ + input_offsets_[from], input_start_y_ + font_metrics_.ascent(),
+                   input_buf_.mid(from));
     }
 
     if (not is_cursor_visible_ or not is_blink_visible_) {
@@ -230,7 +242,7 @@ void HFrame::paintEvent(QPaintEvent* e)
     if (hApp->settings().cursor_shape == Settings::TextCursorShape::Block) {
         p.setPen(hugoColorToQt(bg_color_));
         p.setBackgroundMode(Qt::TransparentMode);
-        p.drawText(QPointF(cursor_pos_.x(), cursor_pos_.y() + m.ascent() + 1),
+        p.drawText(QPointF(cursor_pos_.x(), cursor_pos_.y() + font_metrics_.ascent() + 1),
                    input_buf_.mid(input_current_char_, 1));
     }
 }
@@ -247,18 +259,51 @@ void HFrame::resizeEvent(QResizeEvent* e)
     // Adjust the margins so that we get our final size.
     hApp->updateMargins(-1);
 
-    // Create a new pixmap, using the new size and fill it with the default background color.
-    QPixmap newPixmap(size() * dpr());
+    ensurePixmapCapacity();
+
+    // Areas that just became visible might still contain output from before an earlier shrink.
+    const QSize& oldSize = e->oldSize();
+    if (oldSize.isValid()) {
+        QPainter p(&pixmap_);
+        const QColor& bgColor = hugoColorToQt(bg_color_);
+        if (width() > oldSize.width()) {
+            p.fillRect(oldSize.width(), 0, width() - oldSize.width(), height(), bgColor);
+        }
+        if (height() > oldSize.height()) {
+            p.fillRect(0, oldSize.height(), width(), height() - oldSize.height(), bgColor);
+        }
+    }
+
+    resize_settle_timer_->start();
+}
+
+void HFrame::ensurePixmapCapacity()
+{
+    const QSize& needed = size() * dpr();
+    if (qFuzzyCompare(pixmap_.devicePixelRatio(), dpr()) and needed.width() <= pixmap_.width()
+        and needed.height() <= pixmap_.height()) {
+        return;
+    }
+
+    // Round up to whole chunks so that growing a window by dragging its border doesn't reallocate
+    // on every single resize event.
+    constexpr int chunk = 256;
+    auto roundUp = [](int val) { return (val + chunk - 1) / chunk * chunk; };
+    QSize newSize(roundUp(needed.width()), roundUp(needed.height()));
+    if (qFuzzyCompare(pixmap_.devicePixelRatio(), dpr())) {
+        newSize = newSize.expandedTo(pixmap_.size());
+    }
+
+    // Create a new pixmap and fill it with the default background color.
+    QPixmap newPixmap(newSize);
     newPixmap.setDevicePixelRatio(dpr());
     newPixmap.fill(hugoColorToQt(bg_color_));
 
     // Draw the current pixmap into the new one and use it as our new display.
     QPainter p(&newPixmap);
     p.drawPixmap(0, 0, pixmap_);
+    p.end();
     pixmap_ = newPixmap;
-
-    HugoHandlers::settextmode();
-    display_needs_repaint = true;
 }
 
 void HFrame::keyPressEvent(QKeyEvent* e)
@@ -506,11 +551,10 @@ void HFrame::startInput(int xPos, int yPos)
     input_start_x_ = xPos;
     input_start_y_ = yPos;
     input_current_char_ = 0;
+    resetInputOffsets();
 
-    QMutexLocker mKeyLocker(&key_queue_mutex_);
-    QMutexLocker mClickLocker(&click_queue_mutex_);
-    key_queue_.clear();
-    click_queue_.clear();
+    // The engine thread is blocked waiting for us to return, so it's safe to clear the queue.
+    input_queue_.clear();
 }
 
 void HFrame::getInput(char* buf, size_t buflen)
@@ -520,27 +564,6 @@ void HFrame::getInput(char* buf, size_t buflen)
     input_buf_.clear();
 }
 
-int HFrame::getNextKey()
-{
-    // qDebug() << Q_FUNC_INFO;
-    QMutexLocker mLocker(&key_queue_mutex_);
-    Q_ASSERT(not key_queue_.isEmpty());
-    return key_queue_.dequeue();
-}
-
-QPoint HFrame::getNextClick()
-{
-    QMutexLocker mLocker(&click_queue_mutex_);
-    Q_ASSERT(not click_queue_.isEmpty());
-    return click_queue_.dequeue();
-}
-
-bool HFrame::hasKeyInQueue()
-{
-    QMutexLocker mLocker(&key_queue_mutex_);
-    return not key_queue_.isEmpty();
-}
-
 void HFrame::clearRegion(qreal left, qreal top, qreal right, qreal bottom)
 {
     // qDebug(Q_FUNC_INFO);
@@ -555,7 +578,7 @@ void HFrame::clearRegion(qreal left, qreal top, qreal right, qreal bottom)
     p.fillRect(rect, hugoColorToQt(bg_color_));
 
     // If this was a fullscreen clear, then also clear the margin color.
-    if (rect == pixmap_.rect()) {
+    if (rect == QRectF(this->rect())) {
         hApp->updateMargins(bg_color_);
     }
 }
@@ -580,11 +603,12 @@ void HFrame::setFontType(int hugoFont)
     use_italic_font_ = hugoFont & ITALIC_FONT;
     use_bold_font_ = hugoFont & BOLD_FONT;
 
-    QFont f(use_fixed_font_ ? hApp->settings().fixed_font : hApp->settings().prop_font);
-    f.setUnderline(use_underline_font_);
-    f.setItalic(use_italic_font_);
-    f.setBold(use_bold_font_);
-    font_metrics_ = QFontMetrics(f);
+    font_ = use_fixed_font_ ? hApp->settings().fixed_font : hApp->settings().prop_font;
+    font_.setUnderline(use_underline_font_);
+    font_.setItalic(use_italic_font_);
+    font_.setBold(use_bold_font_);
+    font_metrics_ = QFontMetrics(font_);
+    resetInputOffsets();
 
     // Adjust text caret for new font.
     updateCursorShape();
@@ -644,10 +668,6 @@ void HFrame::flushText()
         return;
     }
 
-    QFont f(use_fixed_font_ ? hApp->settings().fixed_font : hApp->settings().prop_font);
-    f.setUnderline(use_underline_font_);
-    f.setItalic(use_italic_font_);
-    f.setBold(use_bold_font_);
     QPainter p(&pixmap_);
 
     // Manually fill the text background before drawing the text. We need this because
@@ -663,7 +683,7 @@ void HFrame::flushText()
                currentFontMetrics().lineSpacing());
     p.restore();
 
-    p.setFont(f);
+    p.setFont(font_);
     p.setPen(hugoColorToQt(fg_color_));
     p.drawText(flush_pos_x_, flush_pos_y_ + currentFontMetrics().ascent(), print_buf_);
     print_buf_.clear();
@@ -700,14 +720,65 @@ void HFrame::updateCursorPos()
         blinkCursor();
     }
 
-    int xOffs = currentFontMetrics().width(input_buf_.left(input_current_char_));
-    moveCursorPos(QPoint(input_start_x_ + xOffs, input_start_y_));
+    const QRect& dirtyInput = syncInputOffsets();
+    moveCursorPos(QPoint(input_start_x_ + input_offsets_[input_current_char_], input_start_y_));
 
     // Blink-in.
     if (not is_blink_visible_) {
         blinkCursor();
     }
-    update();
+
+    // Only repaint the part of the input line that changed and the cursor at its new position.
+    update(dirtyInput);
+    update(cursor_pos_.x() - 2, cursor_pos_.y() - 2, cursor_width_ + 4, font_metrics_.height() + 4);
+}
+
+QRect HFrame::syncInputOffsets()
+{
+    if (input_measured_ == input_buf_) {
+        return {};
+    }
+
+    // Find the span of characters that changed. Everything before and after it has already been
+    // measured.
+    const int oldLen = input_measured_.length();
+    const int newLen = input_buf_.length();
+    int prefix = 0;
+    while (prefix < oldLen and prefix < newLen and input_measured_[prefix] == input_buf_[prefix]) {
+        ++prefix;
+    }
+    int suffix = 0;
+    while (suffix < oldLen - prefix and suffix < newLen - prefix
+           and input_measured_[oldLen - 1 - suffix] == input_buf_[newLen - 1 - suffix]) {
+        ++suffix;
+    }
+
+    const int oldWidth = input_offsets_.last();
+    QVector<int> offsets = input_offsets_.mid(0, prefix + 1);
+    offsets.reserve(newLen + 1);
+    int x = offsets.last();
+    for (int i = prefix; i < newLen - suffix; ++i) {
+        x += font_metrics_.width(input_buf_[i]);
+        offsets.append(x);
+    }
+    for (int i = oldLen - suffix; i < oldLen; ++i) {
+        x += input_offsets_[i + 1] - input_offsets_[i];
+        offsets.append(x);
+    }
+    input_offsets_ = std::move(offsets);
+    input_measured_ = input_buf_;
+
+    // Leave some room for characters overhanging their advance width.
+    const int left = input_start_x_ + input_offsets_[prefix];
+    const int right = input_start_x_ + qMax(oldWidth, x);
+    return QRect(left, input_start_y_, right - left, font_metrics_.height())
+        .adjusted(-2, -2, font_metrics_.averageCharWidth() + 2, 2);
+}
+
+void HFrame::resetInputOffsets()
+{
+    input_offsets_ = {0};
+    input_measured_.clear();
 }
 
 void HFrame::resetCursorBlinking()
@@ -2,13 +2,14 @@
 #pragma once
 #include <QWidget>
 
+#include <QElapsedTimer>
 #include <QFontMetrics>
 #include <QList>
-#include <QMutex>
-#include <QQueue>
+#include <QVector>
 #include <QWaitCondition>
 
 #include "happlication.h"
+#include "inputqueue.h"
 
 class HFrame;
 class QMenu;
@@ -25,7 +26,7 @@ private:
     enum class InputMode
     {
         // We aren't in input-mode. We still enqueue key presses though, so they can be retrieved
-        // with getNextKey().
+        // with getNextInput().
         None,
 
         // Return-terminated input.
@@ -38,15 +39,11 @@ private:
     // We have a finished user input.
     bool have_input_ready_ = false;
 
-    // Keypress input queue. If an element is 0, it means the input was a mouse click.
-    QQueue<char> key_queue_;
+    // Keypress and mouse click input queue. We push, the engine thread pops.
+    InputQueue input_queue_;
 
-    // Mouse click input queue.
-    QQueue<QPoint> click_queue_;
-
-    // The keypress and click queues are also accessed from the engine thread.
-    QMutex key_queue_mutex_;
-    QMutex click_queue_mutex_;
+    // Limits how often dropped input is reported.
+    QElapsedTimer dropped_input_report_timer_;
 
     // Input buffer.
     QString input_buf_;
@@ -58,6 +55,13 @@ private:
     // Current editor position, in characters. 0 is the start of the current input buffer string.
     int input_current_char_ = 0;
 
+    // Horizontal offset of each character in the input buffer relative to input_start_x_, plus one
+    // more entry for the end of the buffer.
+    QVector<int> input_offsets_{0};
+
+    // The input buffer contents that input_offsets_ currently corresponds to.
+    QString input_measured_;
+
     // Command history buffer.
     QList<QString> history_;
 
@@ -81,11 +85,13 @@ private:
     bool use_italic_font_ = false;
     bool use_bold_font_ = false;
 
-    // Current font metrics.
+    // Current font and its metrics.
+    QFont font_;
     QFontMetrics font_metrics_{QFont()};
 
     // We render game output into a pixmap first instead or painting directly on the widget. We then
-    // draw the pixmap in our paintEvent().
+    // draw the pixmap in our paintEvent(). The pixmap can be larger than the widget; only its
+    // top-left part is visible.
     QPixmap pixmap_{1, 1};
 
     // We buffer text printed with printText() so that we can draw whole strings rather than single
@@ -124,12 +130,27 @@ private:
     // We need a small time delay before minimizing when losing focus while in fullscreen mode.
     QTimer* minimize_timer_;
 
+    // Interactive resizing generates lots of resize events. We only tell the engine about the new
+    // size once resizing settles.
+    QTimer* resize_settle_timer_;
+
+    // Make sure the display pixmap is big enough for the current widget size. The pixmap only grows
+    // (in chunks), so resizing back and forth doesn't reallocate it every time.
+    void ensurePixmapCapacity();
+
     // Add a keypress to our input queue.
     void enqueueKey(char key, QMouseEvent* e);
 
     // Set the height of the text cursor in pixels.
     void updateCursorShape();
 
+    // Bring input_offsets_ up to date with the input buffer. Only characters that were changed since
+    // the last call are measured. Returns the area of the input line that needs repainting.
+    QRect syncInputOffsets();
+
+    // Forget all measured input character offsets. Needed when the font changes.
+    void resetInputOffsets();
+
     // Prevent auto minimize when fullscreen.
     bool prevent_auto_minimize_ = false;
 
@@ -169,22 +190,35 @@ public:
     // The engine thread waits on this until an input line has been entered.
     QWaitCondition inputLineWaitCond;
 
-    // The engine thread waits on this until a keypress is available.
-    QWaitCondition keypressAvailableWaitCond;
-
     // Start reading an input line.
     void startInput(int xPos, int yPos);
 
     // Get the most recently entered input line and clear it.
     void getInput(char* buf, size_t buflen);
 
-    // Returns the next character waiting in the queue. If the queue is empty, it will wait for a
-    // character to become available. Note: if this returns 0, it means the next "key" is a mouse
-    // click; call getNextClick() to get the position of the mouse click.
-    int getNextKey();
+    // Returns the next key press or mouse click waiting in the queue. If the queue is empty, it will
+    // wait for input to become available. Called from the engine thread.
+    InputQueue::Event getNextInput()
+    {
+        return input_queue_.pop();
+    }
+
+    bool hasKeyInQueue() const
+    {
+        return not input_queue_.isEmpty();
+    }
 
-    QPoint getNextClick();
-    bool hasKeyInQueue();
+    // Set how many key presses and clicks can be queued up before further input is dropped.
+    void setInputQueueLimit(int limit)
+    {
+        input_queue_.setLimit(limit);
+    }
+
+    // Amount of key presses and clicks dropped because the input queue was full.
+    quint64 droppedInputCount() const
+    {
+        return input_queue_.droppedCount();
+    }
 
     // Clear a region of the window using the current background color.
     void clearRegion(qreal left, qreal top, qreal right, qreal bottom);
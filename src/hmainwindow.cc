@@ -8,9 +8,7 @@
 #include <QLayout>
 #include <QMenuBar>
 #include <QMessageBox>
-#include <QScrollBar>
 #include <QShortcut>
-#include <QTextCodec>
 #include <QTextEdit>
 #include <QWindowStateChangeEvent>
 
@@ -385,13 +383,7 @@ void HMainWindow::contextMenuEvent(QContextMenuEvent* e)
 
 void HMainWindow::appendToScrollback(const QByteArray& str)
 {
-    if (str.isEmpty()) {
-        return;
-    }
-
-    scrollback_window_->moveCursor(QTextCursor::End);
-    scrollback_window_->insertPlainText(hApp->hugoCodec()->toUnicode(str));
-    scrollback_window_->verticalScrollBar()->triggerAction(QScrollBar::SliderToMaximum);
+    scrollback_window_->appendBytes(str);
 }
 
 void HMainWindow::hideMenuBar()
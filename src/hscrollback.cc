@@ -2,6 +2,10 @@
 #include "hscrollback.h"
 
 #include <QKeyEvent>
+#include <QScrollBar>
+#include <QTextCodec>
+#include <QTextCursor>
+#include <algorithm>
 
 #include "happlication.h"
 #include "hmainwindow.h"
@@ -16,9 +20,109 @@ HScrollbackWindow::HScrollbackWindow(QWidget* parent)
     setTextInteractionFlags(Qt::TextSelectableByMouse);
     setFrameStyle(QFrame::NoFrame | QFrame::Plain);
     setFont(hApp->settings().scrollback_font);
-    // Don't allow the scrollbuffer to grow forever; limit it to fMaximumBlockCount lines.
-    document()->setMaximumBlockCount(max_block_count_);
     resize(initial_width_, initial_height_);
+
+    connect(verticalScrollBar(), &QScrollBar::valueChanged, this, [this](const int value) {
+        if (value == verticalScrollBar()->minimum()) {
+            loadOlderChunks();
+        }
+    });
+}
+
+void HScrollbackWindow::appendBytes(const QByteArray& bytes)
+{
+    if (bytes.isEmpty()) {
+        return;
+    }
+
+    int pos = 0;
+    while (pos < bytes.size()) {
+        if (chunks_.empty() or chunks_.back().size() >= chunk_size_) {
+            chunks_.emplace_back();
+            chunks_.back().reserve(chunk_size_);
+        }
+        auto& chunk = chunks_.back();
+        const int len = std::min(chunk_size_ - chunk.size(), bytes.size() - pos);
+        chunk.append(bytes.constData() + pos, len);
+        pos += len;
+    }
+    total_bytes_ += bytes.size();
+    trimToBudget();
+
+    if (not document_loaded_) {
+        return;
+    }
+    moveCursor(QTextCursor::End);
+    insertPlainText(hApp->hugoCodec()->toUnicode(bytes));
+    verticalScrollBar()->triggerAction(QScrollBar::SliderToMaximum);
+}
+
+void HScrollbackWindow::trimToBudget()
+{
+    // Never drop the chunk that's currently being filled.
+    while (total_bytes_ > max_bytes_ and chunks_.size() > 1) {
+        if (document_loaded_ and first_loaded_chunk_ == 0) {
+            removeLeadingText(hApp->hugoCodec()->toUnicode(chunks_.front()).size());
+        }
+        total_bytes_ -= chunks_.front().size();
+        chunks_.pop_front();
+        if (first_loaded_chunk_ > 0) {
+            --first_loaded_chunk_;
+        }
+    }
+}
+
+void HScrollbackWindow::removeLeadingText(const int len)
+{
+    auto* const bar = verticalScrollBar();
+    const int dist_from_bottom = bar->maximum() - bar->value();
+    QTextCursor cursor(document());
+    cursor.movePosition(QTextCursor::Start);
+    cursor.movePosition(QTextCursor::NextCharacter, QTextCursor::KeepAnchor, len);
+    cursor.removeSelectedText();
+    bar->setValue(bar->maximum() - dist_from_bottom);
+}
+
+void HScrollbackWindow::loadTail()
+{
+    first_loaded_chunk_ = chunks_.size();
+    int bytes = 0;
+    while (first_loaded_chunk_ > 0 and bytes < initial_load_bytes_) {
+        --first_loaded_chunk_;
+        bytes += chunks_[first_loaded_chunk_].size();
+    }
+
+    QByteArray tail;
+    tail.reserve(bytes);
+    for (size_t i = first_loaded_chunk_; i < chunks_.size(); ++i) {
+        tail += chunks_[i];
+    }
+    setPlainText(hApp->hugoCodec()->toUnicode(tail));
+    document_loaded_ = true;
+    moveCursor(QTextCursor::End);
+    verticalScrollBar()->triggerAction(QScrollBar::SliderToMaximum);
+}
+
+void HScrollbackWindow::loadOlderChunks()
+{
+    if (not document_loaded_ or first_loaded_chunk_ == 0) {
+        return;
+    }
+
+    --first_loaded_chunk_;
+    auto* const bar = verticalScrollBar();
+    const int dist_from_bottom = bar->maximum() - bar->value();
+    QTextCursor cursor(document());
+    cursor.movePosition(QTextCursor::Start);
+    cursor.insertText(hApp->hugoCodec()->toUnicode(chunks_[first_loaded_chunk_]));
+    // Keep the text the user was looking at in place.
+    bar->setValue(bar->maximum() - dist_from_bottom);
+}
+
+void HScrollbackWindow::unloadDocument()
+{
+    document_loaded_ = false;
+    clear();
 }
 
 void HScrollbackWindow::keyPressEvent(QKeyEvent* e)
@@ -39,6 +143,24 @@ void HScrollbackWindow::closeEvent(QCloseEvent* e)
     hMainWin->hideScrollback();
 }
 
+void HScrollbackWindow::showEvent(QShowEvent* e)
+{
+    if (not document_loaded_) {
+        loadTail();
+    }
+    QTextEdit::showEvent(e);
+}
+
+void HScrollbackWindow::hideEvent(QHideEvent* e)
+{
+    // Free the laid out text; the raw bytes are all we need to rebuild it next time. Spontaneous
+    // hide events (like the window getting minimized) don't count.
+    if (not e->spontaneous()) {
+        unloadDocument();
+    }
+    QTextEdit::hideEvent(e);
+}
+
 /* Copyright (C) 2011-2019 Nikos Chantziaras
  *
  * This file is part of Hugor.
@@ -1,6 +1,8 @@
 // This is copyrighted software. More information is at the end of this file.
 #pragma once
+#include <QByteArray>
 #include <QTextEdit>
+#include <deque>
 
 class HScrollbackWindow final: public QTextEdit
 {
@@ -9,14 +11,39 @@ class HScrollbackWindow final: public QTextEdit
 public:
     HScrollbackWindow(QWidget* parent = nullptr);
 
+    // Appends raw, codec-encoded game text. While the window is hidden, this only stores the
+    // bytes; no text layout happens until the window is shown.
+    void appendBytes(const QByteArray& bytes);
+
 protected:
     void keyPressEvent(QKeyEvent* e) override;
     void closeEvent(QCloseEvent* e) override;
+    void showEvent(QShowEvent* e) override;
+    void hideEvent(QHideEvent* e) override;
 
 private:
-    int max_block_count_ = 7000;
+    // Scrollback text is kept in a ring of fixed-size chunks. Old chunks are dropped once the
+    // total exceeds max_bytes_. Only the chunks from first_loaded_chunk_ onwards are present in
+    // the text document; older ones are loaded on demand when the user scrolls to the top.
+    std::deque<QByteArray> chunks_;
+    qint64 total_bytes_ = 0;
+    size_t first_loaded_chunk_ = 0;
+    bool document_loaded_ = false;
+
+    static constexpr int chunk_size_ = 16 * 1024;
+    static constexpr qint64 max_bytes_ = 4 * 1024 * 1024;
+    // How much text to lay out initially when the window is shown.
+    static constexpr int initial_load_bytes_ = 64 * 1024;
     int initial_width_ = 600;
     int initial_height_ = 440;
+
+    // Drops chunks until we're within max_bytes_. Text of dropped chunks that is in the document
+    // is removed from it too.
+    void trimToBudget();
+    void removeLeadingText(int len);
+    void loadTail();
+    void loadOlderChunks();
+    void unloadDocument();
 };
 
 /* Copyright (C) 2011-2019 Nikos Chantziaras
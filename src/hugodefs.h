@@ -15,6 +15,7 @@ bool isMusicPlaying();
 bool isSamplePlaying();
 void updateSoundVolume();
 void updateSynthGain();
+void updateAudioPeriod();
 void updateVideoVolume();
 
 // Defined Hugo colors.
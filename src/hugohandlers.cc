@@ -13,6 +13,7 @@
 #include "hframe.h"
 #include "hmainwindow.h"
 #include "hugorfile.h"
+#include "picturecache.h"
 #include "settings.h"
 #include "videoplayer.h"
 
@@ -227,39 +228,17 @@ void HugoHandlers::setbackcolor(int c)
 // FIXME: Check for errors when loading images.
 void HugoHandlers::displaypicture(HUGO_FILE infile, long len, int* result)
 {
-    // Open it as a QFile.
-    long pos = ftell(infile->get());
-    QFile file;
-    file.open(infile->get(), QIODevice::ReadOnly);
-    file.seek(pos);
-
-    // Load the data into a byte array.
-    const QByteArray& data = file.read(len);
-
-    // Create the image from the data.
-    // FIXME: Allow only JPEG images. By default, QImage supports all image formats recognized by
-    // Qt.
-    QImage img;
-    img.loadFromData(data);
-    const auto dpr = hMainWin->windowHandle()->devicePixelRatio();
-    img.setDevicePixelRatio(dpr);
-
-    // Scale the image, if needed.
-    QSize imgSize(img.size());
-    if (img.width() > physical_windowwidth) {
-        imgSize.setWidth(physical_windowwidth);
-    }
-    if (img.height() > physical_windowheight) {
-        imgSize.setHeight(physical_windowheight);
-    }
-    // Make sure to keep the aspect ratio (don't stretch.)
-    if (imgSize != img.size()) {
-        img = img.scaled(imgSize * dpr, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-        imgSize = img.size() / dpr;
-    } else if (not qFuzzyCompare(dpr, 1.0)) {
-        img = img.scaled(img.size() * dpr, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    const auto& sett = hApp->settings();
+    if (sett.prefetch_pictures) {
+        pictureCache().prefetch(QString::fromLocal8Bit(infile->path().c_str()));
     }
 
+    // Get the image scaled to the current window, decoding it only if it's not cached.
+    const auto dpr = hMainWin->windowHandle()->devicePixelRatio();
+    const QImage& img = pictureCache().image(
+        infile, len, QSize(physical_windowwidth, physical_windowheight), dpr);
+    const QSize imgSize(img.size() / dpr);
+
     // The image should be displayed centered.
     int x = (physical_windowwidth - imgSize.width()) / 2 + physical_windowleft;
     int y = (physical_windowheight - imgSize.height()) / 2 + physical_windowtop;
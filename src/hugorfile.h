@@ -1,12 +1,15 @@
 // This is copyrighted software. More information is at the end of this file.
 #pragma once
 #include <cstdio>
+#include <string>
+#include <utility>
 
 struct HugorFile final
 {
 public:
-    explicit HugorFile(FILE* const handle) noexcept
+    explicit HugorFile(FILE* const handle, std::string path = {}) noexcept
         : handle_(handle)
+        , path_(std::move(path))
     {}
 
     ~HugorFile() noexcept
@@ -22,6 +25,12 @@ public:
         return handle_;
     }
 
+    // Path the file was opened with. Empty for virtual files.
+    const std::string& path() const noexcept
+    {
+        return path_;
+    }
+
     FILE* release() noexcept
     {
         auto* tmp = handle_;
@@ -41,6 +50,7 @@ public:
 
 private:
     FILE* handle_;
+    std::string path_;
 };
 
 /* Copyright (C) 2011-2019 Nikos Chantziaras
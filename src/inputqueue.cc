@@ -0,0 +1,73 @@
+// This is copyrighted software. More information is at the end of this file.
+#include "inputqueue.h"
+
+#include <QMutexLocker>
+#include <QtGlobal>
+
+void InputQueue::setLimit(const int limit)
+{
+    limit_ = qBound(1, limit, capacity);
+}
+
+bool InputQueue::push(const char key, const QPoint& click_pos)
+{
+    const unsigned head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) >= static_cast<unsigned>(limit_.load())) {
+        ++dropped_;
+        return false;
+    }
+    events_[head % capacity] = {key, click_pos};
+    // Sequentially consistent, so that either we see the consumer's waiting flag below, or the
+    // consumer sees the new event before going to sleep.
+    head_.store(head + 1);
+
+    if (consumer_waiting_.load()) {
+        QMutexLocker locker(&wait_mutex_);
+        wait_cond_.wakeOne();
+    }
+    return true;
+}
+
+InputQueue::Event InputQueue::pop()
+{
+    const unsigned tail = tail_.load(std::memory_order_relaxed);
+    if (head_.load(std::memory_order_acquire) == tail) {
+        QMutexLocker locker(&wait_mutex_);
+        consumer_waiting_.store(true);
+        while (head_.load() == tail) {
+            wait_cond_.wait(&wait_mutex_);
+        }
+        consumer_waiting_.store(false, std::memory_order_relaxed);
+    }
+    const Event ev = events_[tail % capacity];
+    tail_.store(tail + 1, std::memory_order_release);
+    return ev;
+}
+
+bool InputQueue::isEmpty() const
+{
+    return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_relaxed);
+}
+
+void InputQueue::clear()
+{
+    tail_.store(head_.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+/* Copyright (C) 2011-2019 Nikos Chantziaras
+ *
+ * This file is part of Hugor.
+ *
+ * Hugor is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Hugor is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Hugor.  If not, see <http://www.gnu.org/licenses/>.
+ */
@@ -0,0 +1,82 @@
+// This is copyrighted software. More information is at the end of this file.
+#pragma once
+#include <QMutex>
+#include <QPoint>
+#include <QWaitCondition>
+
+#include <array>
+#include <atomic>
+
+/* Bounded queue of key presses and mouse clicks, passed from the GUI thread (the only producer) to
+ * the engine thread (the only consumer.)
+ *
+ * Pushing and popping are lock-free. A mutex is only taken when the consumer has to go to sleep
+ * because the queue is empty, and by the producer only when it needs to wake up a sleeping
+ * consumer.
+ */
+class InputQueue final
+{
+public:
+    struct Event
+    {
+        // The key, or 0 if this is a mouse click.
+        char key;
+        QPoint click_pos;
+    };
+
+    // Upper bound for setLimit().
+    static constexpr int capacity = 64;
+
+    // Set the maximum amount of pending events. Input arriving while the queue is full is dropped.
+    void setLimit(int limit);
+
+    // Producer side. Returns false if the event had to be dropped.
+    bool push(char key, const QPoint& click_pos = {});
+
+    // Consumer side. Returns the oldest event, waiting for one to arrive if the queue is empty.
+    Event pop();
+
+    bool isEmpty() const;
+
+    // Discard all pending events. This must only be called while the consumer is known to not be
+    // accessing the queue, like when it's blocked waiting for the GUI thread.
+    void clear();
+
+    // How many events were dropped because the queue was full.
+    quint64 droppedCount() const
+    {
+        return dropped_;
+    }
+
+private:
+    std::array<Event, capacity> events_;
+
+    // Free running counters. Only the producer writes head_ and only the consumer writes tail_.
+    std::atomic_uint head_{0};
+    std::atomic_uint tail_{0};
+
+    std::atomic_int limit_{1};
+    std::atomic<quint64> dropped_{0};
+
+    std::atomic_bool consumer_waiting_{false};
+    QMutex wait_mutex_;
+    QWaitCondition wait_cond_;
+};
+
+/* Copyright (C) 2011-2019 Nikos Chantziaras
+ *
+ * This file is part of Hugor.
+ *
+ * Hugor is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Hugor is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Hugor.  If not, see <http://www.gnu.org/licenses/>.
+ */
@@ -3,14 +3,28 @@
 #include <Aulib/Processor.h>
 
 #include <algorithm>
+#include <optional>
 
 /* Used to boost the volume of the OPL emulator's output, since it is rather quiet.
  */
 class OplVolumeBooster final: public Aulib::Processor
 {
+    static constexpr float GAIN = 2.5f;
+
     void process(float dest[], const float source[], int len) override
     {
-        std::transform(source, source + len, dest, [](float sample) { return sample * 2.5f; });
+        std::transform(source, source + len, dest, [](float sample) { return sample * GAIN; });
+    }
+
+    auto canProcessInPlace() const -> bool override
+    {
+        return true;
+    }
+
+    // Lets the stream fold the boost into its mixing volume instead of running us.
+    auto pureGain() const -> std::optional<float> override
+    {
+        return GAIN;
     }
 };
 
@@ -0,0 +1,130 @@
+// This is copyrighted software. More information is at the end of this file.
+#include "pcmdecoder.h"
+
+#include "Aulib/Resampler.h"
+#include "aulib.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+static std::shared_ptr<const PcmBuffer>
+decodeAllImpl(SDL_RWops* rwops, std::unique_ptr<Aulib::Decoder> decoder,
+              std::unique_ptr<Aulib::Resampler> resampler,
+              const std::chrono::milliseconds max_duration)
+{
+    if (not decoder->open(rwops) or decoder->duration() > max_duration) {
+        return nullptr;
+    }
+
+    resampler->setDecoder(std::move(decoder));
+    resampler->setSpec(Aulib::sampleRate(), Aulib::channelCount(), Aulib::frameSize());
+
+    // Not all decoders know their duration, so we also check the length while decoding.
+    const auto max_samples = static_cast<size_t>(max_duration.count()) * Aulib::sampleRate()
+                             / 1000 * Aulib::channelCount();
+    auto buffer = std::make_shared<PcmBuffer>();
+    std::array<float, 4096> chunk;
+    while (true) {
+        const int len = resampler->resample(chunk.data(), chunk.size());
+        if (len <= 0) {
+            break;
+        }
+        buffer->insert(buffer->end(), chunk.begin(), chunk.begin() + len);
+        if (buffer->size() > max_samples) {
+            return nullptr;
+        }
+    }
+    if (buffer->empty()) {
+        return nullptr;
+    }
+    buffer->shrink_to_fit();
+    return buffer;
+}
+
+std::shared_ptr<const PcmBuffer>
+PcmDecoder::decodeAll(SDL_RWops* rwops, std::unique_ptr<Aulib::Decoder> decoder,
+                      std::unique_ptr<Aulib::Resampler> resampler,
+                      const std::chrono::milliseconds max_duration)
+{
+    const auto rw_pos = SDL_RWtell(rwops);
+    auto buffer = decodeAllImpl(rwops, std::move(decoder), std::move(resampler), max_duration);
+    SDL_RWseek(rwops, rw_pos, RW_SEEK_SET);
+    return buffer;
+}
+
+void PcmDecoder::setBuffer(std::shared_ptr<const PcmBuffer> buffer) noexcept
+{
+    buffer_ = std::move(buffer);
+    pos_ = 0;
+}
+
+bool PcmDecoder::open(SDL_RWops* /*rwops*/)
+{
+    setIsOpen(true);
+    return true;
+}
+
+int PcmDecoder::getChannels() const
+{
+    return Aulib::channelCount();
+}
+
+int PcmDecoder::getRate() const
+{
+    return Aulib::sampleRate();
+}
+
+bool PcmDecoder::rewind()
+{
+    pos_ = 0;
+    return true;
+}
+
+std::chrono::microseconds PcmDecoder::duration() const
+{
+    if (not buffer_) {
+        return {};
+    }
+    const auto frames = static_cast<long long>(buffer_->size() / Aulib::channelCount());
+    return std::chrono::microseconds(frames * 1'000'000 / Aulib::sampleRate());
+}
+
+bool PcmDecoder::seekToTime(const std::chrono::microseconds pos)
+{
+    if (not buffer_) {
+        return false;
+    }
+    const auto frame = static_cast<size_t>(pos.count()) * Aulib::sampleRate() / 1'000'000;
+    pos_ = std::min(frame * Aulib::channelCount(), buffer_->size());
+    return true;
+}
+
+int PcmDecoder::doDecoding(float buf[], const int len, bool& callAgain)
+{
+    callAgain = false;
+    if (not buffer_) {
+        return 0;
+    }
+    const auto count = std::min(static_cast<size_t>(len), buffer_->size() - pos_);
+    std::memcpy(buf, buffer_->data() + pos_, count * sizeof(*buf));
+    pos_ += count;
+    return count;
+}
+
+/* Copyright (C) 2011-2019 Nikos Chantziaras
+ *
+ * This file is part of Hugor.
+ *
+ * Hugor is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Hugor is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Hugor.  If not, see <http://www.gnu.org/licenses/>.
+ */
@@ -0,0 +1,64 @@
+// This is copyrighted software. More information is at the end of this file.
+#pragma once
+#include "Aulib/Decoder.h"
+#include "Aulib/Resampler.h"
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+// Interleaved float samples at the output sample rate and channel count.
+using PcmBuffer = std::vector<float>;
+
+/* Plays audio that has already been decoded and resampled to the output format, so playing it
+ * costs nothing more than a copy. The same decoder can be pointed at different buffers, which
+ * allows a stream to be reused for different sounds.
+ */
+class PcmDecoder final: public Aulib::Decoder
+{
+public:
+    /* Decodes all of the audio in 'rwops' using 'decoder' and resamples it to the output format
+     * using 'resampler'. Returns null if the audio can't be decoded or is longer than
+     * 'max_duration'. The RWops is not closed, and is positioned back to where it was when this
+     * was called.
+     */
+    static std::shared_ptr<const PcmBuffer> decodeAll(SDL_RWops* rwops,
+                                                      std::unique_ptr<Aulib::Decoder> decoder,
+                                                      std::unique_ptr<Aulib::Resampler> resampler,
+                                                      std::chrono::milliseconds max_duration);
+
+    // Must not be called while the stream this decoder belongs to is playing.
+    void setBuffer(std::shared_ptr<const PcmBuffer> buffer) noexcept;
+
+    bool open(SDL_RWops* rwops) override;
+    int getChannels() const override;
+    int getRate() const override;
+    bool rewind() override;
+    std::chrono::microseconds duration() const override;
+    bool seekToTime(std::chrono::microseconds pos) override;
+
+protected:
+    int doDecoding(float buf[], int len, bool& callAgain) override;
+
+private:
+    std::shared_ptr<const PcmBuffer> buffer_;
+    size_t pos_ = 0;
+};
+
+/* Copyright (C) 2011-2019 Nikos Chantziaras
+ *
+ * This file is part of Hugor.
+ *
+ * Hugor is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Hugor is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Hugor.  If not, see <http://www.gnu.org/licenses/>.
+ */
@@ -0,0 +1,288 @@
+// This is copyrighted software. More information is at the end of this file.
+#include "picturecache.h"
+
+#include <QBuffer>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <climits>
+#include <cstdio>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "hugorfile.h"
+
+static qint64 imageBytes(const QImage& img)
+{
+    return static_cast<qint64>(img.bytesPerLine()) * img.height();
+}
+
+// Scales the image the same way the engine expects pictures to be displayed: shrunk to fit into
+// the window if needed, never stretched, and in device pixels.
+static QImage scaleToFit(const QImage& img, const QSize& max_size, const qreal dpr)
+{
+    QSize img_size(img.size());
+    if (img.width() > max_size.width()) {
+        img_size.setWidth(max_size.width());
+    }
+    if (img.height() > max_size.height()) {
+        img_size.setHeight(max_size.height());
+    }
+
+    QImage scaled;
+    // Make sure to keep the aspect ratio (don't stretch.)
+    if (img_size != img.size()) {
+        scaled = img.scaled(img_size * dpr, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    } else if (not qFuzzyCompare(dpr, 1.0)) {
+        scaled = img.scaled(img.size() * dpr, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    } else {
+        return img;
+    }
+    scaled.setDevicePixelRatio(dpr);
+    return scaled;
+}
+
+class PictureCache::PrefetchJob final: public QRunnable
+{
+public:
+    PrefetchJob(PictureCache* cache, QString path)
+        : cache_(cache)
+        , path_(std::move(path))
+    {}
+
+    void run() override;
+
+private:
+    PictureCache* cache_;
+    QString path_;
+};
+
+// Reads the resource file directory the same way FindResource() in heres.c does and decodes every
+// JPEG resource in it.
+void PictureCache::PrefetchJob::run()
+{
+    QFile file(path_);
+    if (not file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    auto readNum = [&file](const int bytes) -> long {
+        long val = 0;
+        for (int i = 0; i < bytes; ++i) {
+            char c;
+            if (not file.getChar(&c)) {
+                return -1;
+            }
+            val += static_cast<long>(static_cast<unsigned char>(c)) << (8 * i);
+        }
+        return val;
+    };
+
+    const long type = readNum(1);
+    if (type != 'r' and type != 'R') {
+        return;
+    }
+    // Older resource files store positions and lengths as 24 bit values.
+    const int num_size = type == 'r' ? 4 : 3;
+    // Ignore the resource file version.
+    readNum(1);
+    const long count = readNum(2);
+    const long start_of_data = readNum(2);
+    if (count < 0 or start_of_data < 0) {
+        return;
+    }
+
+    struct Resource
+    {
+        long pos;
+        long len;
+    };
+    std::vector<Resource> resources;
+    resources.reserve(count);
+    for (long i = 0; i < count; ++i) {
+        const long name_len = readNum(1);
+        if (name_len < 0 or not file.seek(file.pos() + name_len)) {
+            return;
+        }
+        const long pos = readNum(num_size);
+        const long len = readNum(num_size);
+        if (pos < 0 or len <= 0) {
+            return;
+        }
+        resources.push_back({start_of_data + pos, len});
+    }
+
+    for (const auto& res : resources) {
+        if (cache_->abort_prefetch_) {
+            return;
+        }
+        char first_byte;
+        if (res.pos + res.len > file.size() or not file.seek(res.pos)
+            or not file.getChar(&first_byte)) {
+            continue;
+        }
+        // Only JPEG pictures, same as DisplayPicture() in heres.c. Music and samples share the
+        // resource file.
+        if (static_cast<unsigned char>(first_byte) != 0xff) {
+            continue;
+        }
+
+        const auto& key = makeKey(path_, res.pos, res.len);
+        file.seek(res.pos);
+        QByteArray data = file.read(res.len);
+        QBuffer buf(&data);
+        QImageReader reader(&buf);
+        const QSize& size = reader.size();
+        // Decoded JPEGs are 32 bits per pixel.
+        if (not size.isValid()
+            or not cache_->hasRoomFor(key, static_cast<qint64>(size.width()) * size.height() * 4)) {
+            continue;
+        }
+        const QImage& img = reader.read();
+        if (not img.isNull()) {
+            cache_->insertIfRoom(key, img);
+        }
+    }
+}
+
+PictureCache::PictureCache()
+{
+    prefetch_pool_.setMaxThreadCount(1);
+}
+
+PictureCache::~PictureCache()
+{
+    clear();
+}
+
+QImage PictureCache::image(HugorFile* infile, const long len, const QSize& max_size,
+                           const qreal dpr)
+{
+    const long pos = std::ftell(infile->get());
+    const auto& key = makeKey(QString::fromLocal8Bit(infile->path().c_str()), pos, len);
+
+    QMutexLocker locker(&mutex_);
+    QImage decoded;
+    if (const Entry* entry = cache_.object(key)) {
+        if (entry->scaled_for == max_size and qFuzzyCompare(entry->scaled_dpr, dpr)) {
+            return entry->scaled;
+        }
+        decoded = entry->decoded;
+    }
+    locker.unlock();
+
+    if (decoded.isNull()) {
+        QFile file;
+        file.open(infile->get(), QIODevice::ReadOnly);
+        file.seek(pos);
+        // FIXME: Allow only JPEG images. By default, QImage supports all image formats recognized
+        // by Qt.
+        decoded.loadFromData(file.read(len));
+        if (decoded.isNull()) {
+            return decoded;
+        }
+    }
+
+    auto entry = std::make_unique<Entry>();
+    entry->decoded = decoded;
+    entry->scaled = scaleToFit(decoded, max_size, dpr);
+    entry->scaled_for = max_size;
+    entry->scaled_dpr = dpr;
+    const QImage img = entry->scaled;
+    const int cost = entryCost(*entry);
+
+    locker.relock();
+    // If the picture alone exceeds the budget, this deletes the entry right away.
+    cache_.insert(key, entry.release(), cost);
+    return img;
+}
+
+void PictureCache::setMaxBytes(const qint64 bytes)
+{
+    QMutexLocker locker(&mutex_);
+    cache_.setMaxCost(static_cast<int>(qBound<qint64>(0, bytes / 1024, INT_MAX)));
+}
+
+void PictureCache::prefetch(const QString& path)
+{
+    QMutexLocker locker(&mutex_);
+    if (path.isEmpty() or prefetched_files_.contains(path) or cache_.maxCost() == 0) {
+        return;
+    }
+    prefetched_files_.insert(path);
+    locker.unlock();
+    prefetch_pool_.start(new PrefetchJob(this, path));
+}
+
+void PictureCache::clear()
+{
+    abort_prefetch_ = true;
+    prefetch_pool_.waitForDone();
+    abort_prefetch_ = false;
+
+    QMutexLocker locker(&mutex_);
+    cache_.clear();
+    prefetched_files_.clear();
+}
+
+QString PictureCache::makeKey(const QString& path, const long pos, const long len)
+{
+    return QFileInfo(path).absoluteFilePath() + QLatin1Char(':') + QString::number(pos)
+           + QLatin1Char(':') + QString::number(len);
+}
+
+int PictureCache::entryCost(const Entry& entry)
+{
+    qint64 bytes = imageBytes(entry.decoded);
+    // Unscaled pictures share their data with the decoded image.
+    if (entry.scaled.cacheKey() != entry.decoded.cacheKey()) {
+        bytes += imageBytes(entry.scaled);
+    }
+    return static_cast<int>(qBound<qint64>(1, bytes / 1024, INT_MAX));
+}
+
+bool PictureCache::hasRoomFor(const QString& key, const qint64 bytes)
+{
+    QMutexLocker locker(&mutex_);
+    return not cache_.contains(key) and cache_.totalCost() + bytes / 1024 <= cache_.maxCost();
+}
+
+bool PictureCache::insertIfRoom(const QString& key, const QImage& img)
+{
+    auto entry = std::make_unique<Entry>();
+    entry->decoded = img;
+    const int cost = entryCost(*entry);
+
+    QMutexLocker locker(&mutex_);
+    if (cache_.contains(key) or cache_.totalCost() + cost > cache_.maxCost()) {
+        return false;
+    }
+    return cache_.insert(key, entry.release(), cost);
+}
+
+PictureCache& pictureCache()
+{
+    static PictureCache cache;
+    return cache;
+}
+
+/* Copyright (C) 2011-2019 Nikos Chantziaras
+ *
+ * This file is part of Hugor.
+ *
+ * Hugor is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Hugor is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Hugor.  If not, see <http://www.gnu.org/licenses/>.
+ */
@@ -0,0 +1,92 @@
+// This is copyrighted software. More information is at the end of this file.
+#pragma once
+#include <QCache>
+#include <QImage>
+#include <QMutex>
+#include <QSet>
+#include <QThreadPool>
+
+#include <atomic>
+
+struct HugorFile;
+
+/* LRU cache of decoded pictures, bounded by a memory budget.
+ *
+ * Pictures are identified by the file they are stored in and their offset and length inside that
+ * file, so the same resource is recognized regardless of how the game refers to it. Each entry
+ * keeps the decoded image and the most recent display-scaled version of it, so redisplaying a
+ * picture in an unchanged window needs neither decoding nor scaling.
+ */
+class PictureCache final
+{
+public:
+    PictureCache();
+    ~PictureCache();
+
+    PictureCache(const PictureCache&) = delete;
+    PictureCache& operator=(const PictureCache&) = delete;
+
+    // Returns the picture of length 'len' at the current position of 'infile', scaled down to fit
+    // into 'max_size' while keeping the aspect ratio, with 'dpr' as the device pixel ratio. The
+    // picture is decoded only if it's not in the cache.
+    QImage image(HugorFile* infile, long len, const QSize& max_size, qreal dpr);
+
+    // Change the memory budget. Least recently used pictures are dropped to stay below it.
+    void setMaxBytes(qint64 bytes);
+
+    // Decode all pictures of the resource file at 'path' in a background thread, as long as they
+    // fit into the memory budget. Does nothing if the file was already prefetched.
+    void prefetch(const QString& path);
+
+    // Stop prefetching and drop all cached pictures.
+    void clear();
+
+private:
+    class PrefetchJob;
+
+    struct Entry
+    {
+        QImage decoded;
+        QImage scaled;
+        QSize scaled_for;
+        qreal scaled_dpr = 0.0;
+    };
+
+    // Cost is in KiB; QCache uses an int for it.
+    QCache<QString, Entry> cache_;
+    QMutex mutex_;
+    QSet<QString> prefetched_files_;
+    QThreadPool prefetch_pool_;
+    std::atomic_bool abort_prefetch_{false};
+
+    static QString makeKey(const QString& path, long pos, long len);
+    static int entryCost(const Entry& entry);
+
+    // Whether a picture that isn't cached yet and needs 'bytes' of memory would fit into the budget.
+    bool hasRoomFor(const QString& key, qint64 bytes);
+
+    // Inserts a decoded picture unless doing so would evict other pictures. Used by the prefetcher,
+    // which should never push out pictures that were actually displayed.
+    bool insertIfRoom(const QString& key, const QImage& img);
+};
+
+// The application-wide picture cache.
+PictureCache& pictureCache();
+
+/* Copyright (C) 2011-2019 Nikos Chantziaras
+ *
+ * This file is part of Hugor.
+ *
+ * Hugor is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Hugor is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Hugor.  If not, see <http://www.gnu.org/licenses/>.
+ */
@@ -0,0 +1,135 @@
+// This is copyrighted software. More information is at the end of this file.
+#include "resamplerfactory.h"
+
+#include "Aulib/ResamplerSdl.h"
+#include "Aulib/ResamplerSpeex.h"
+#if USE_RESAMP_SRC
+#include "Aulib/ResamplerSrc.h"
+#endif
+#if USE_RESAMP_SOXR
+#include "Aulib/ResamplerSox.h"
+#endif
+#include <utility>
+
+using Type = Settings::ResamplerType;
+using Quality = Settings::ResamplerQuality;
+
+// The automatic policy. Music plays for minutes and is decoded ahead in a background thread, so it
+// gets the best quality. Streamed sound effects are resampled inside the audio callback and get a
+// shorter filter, which costs less CPU time and adds less delay. Short sound effects are resampled
+// on the GUI thread right before they start playing, so they get the cheapest filter. See
+// SDL_audiolib/example/resamplerbench.cpp for the CPU cost of each resampler and quality.
+static std::pair<Type, Quality> automaticResampler(const ResamplerUse use)
+{
+    switch (use) {
+    case ResamplerUse::Music:
+#if USE_RESAMP_SOXR
+        return {Type::Soxr, Quality::Best};
+#else
+        return {Type::Speex, Quality::Best};
+#endif
+    case ResamplerUse::StreamedSample:
+        return {Type::Speex, Quality::Balanced};
+    case ResamplerUse::PredecodedSample:
+        break;
+    }
+    return {Type::Speex, Quality::Fast};
+}
+
+bool isResamplerAvailable(const Type type)
+{
+    switch (type) {
+    case Type::Automatic:
+    case Type::Speex:
+        return true;
+    case Type::Sdl:
+        return SDL_VERSION_ATLEAST(2, 0, 7);
+    case Type::Src:
+#if USE_RESAMP_SRC
+        return true;
+#else
+        return false;
+#endif
+    case Type::Soxr:
+#if USE_RESAMP_SOXR
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+std::unique_ptr<Aulib::Resampler> makeResampler(Type type, Quality quality, const ResamplerUse use)
+{
+    if (type == Type::Automatic or not isResamplerAvailable(type)) {
+        std::tie(type, quality) = automaticResampler(use);
+    }
+
+    switch (type) {
+    case Type::Automatic:
+    case Type::Speex:
+        break;
+    case Type::Sdl:
+#if SDL_VERSION_ATLEAST(2, 0, 7)
+        // SDL's resampler has no quality setting.
+        return std::make_unique<Aulib::ResamplerSdl>();
+#else
+        break;
+#endif
+    case Type::Src:
+#if USE_RESAMP_SRC
+        switch (quality) {
+        case Quality::Fast:
+            return std::make_unique<Aulib::ResamplerSrc>(Aulib::ResamplerSrc::Quality::SincFastest);
+        case Quality::Balanced:
+            return std::make_unique<Aulib::ResamplerSrc>(Aulib::ResamplerSrc::Quality::SincMedium);
+        case Quality::Best:
+            return std::make_unique<Aulib::ResamplerSrc>(Aulib::ResamplerSrc::Quality::SincBest);
+        }
+#endif
+        break;
+    case Type::Soxr:
+#if USE_RESAMP_SOXR
+        switch (quality) {
+        case Quality::Fast:
+            return std::make_unique<Aulib::ResamplerSox>(Aulib::ResamplerSox::Quality::Low);
+        case Quality::Balanced:
+            return std::make_unique<Aulib::ResamplerSox>(Aulib::ResamplerSox::Quality::High);
+        case Quality::Best:
+            return std::make_unique<Aulib::ResamplerSox>(Aulib::ResamplerSox::Quality::VeryHigh);
+        }
+#endif
+        break;
+    }
+
+    // Speex quality levels go from 0 to 10. 3 is what Speex uses for VoIP, 5 for desktop audio. 10
+    // needs about three times the CPU time of 8, so we stop at 8.
+    switch (quality) {
+    case Quality::Fast:
+        return std::make_unique<Aulib::ResamplerSpeex>(3);
+    case Quality::Balanced:
+        break;
+    case Quality::Best:
+        return std::make_unique<Aulib::ResamplerSpeex>(8);
+    }
+    return std::make_unique<Aulib::ResamplerSpeex>(5);
+}
+
+/* Copyright (C) 2011-2019 Nikos Chantziaras
+ *
+ * This file is part of Hugor.
+ *
+ * Hugor is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Hugor is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Hugor.  If not, see <http://www.gnu.org/licenses/>.
+ */
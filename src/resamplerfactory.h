@@ -0,0 +1,47 @@
+// This is copyrighted software. More information is at the end of this file.
+#pragma once
+#include <memory>
+
+#include "settings.h"
+
+namespace Aulib {
+class Resampler;
+} // namespace Aulib
+
+// What a resampler is needed for. The automatic resampler type uses this to pick a resampler.
+enum class ResamplerUse
+{
+    Music,
+    // Sound effects that are too long to pre-decode and are resampled while they play.
+    StreamedSample,
+    // Short sound effects that are resampled once, when they're decoded into the sample cache.
+    PredecodedSample,
+};
+
+// Whether support for the given resampler type was compiled in. Automatic is always available.
+bool isResamplerAvailable(Settings::ResamplerType type);
+
+// Creates a resampler of the given type and quality. Types that aren't available fall back to the
+// automatic type, which ignores 'quality' and picks both the resampler and its quality for 'use'.
+// Can be called from any thread.
+std::unique_ptr<Aulib::Resampler> makeResampler(Settings::ResamplerType type,
+                                                Settings::ResamplerQuality quality,
+                                                ResamplerUse use);
+
+/* Copyright (C) 2011-2019 Nikos Chantziaras
+ *
+ * This file is part of Hugor.
+ *
+ * Hugor is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Hugor is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Hugor.  If not, see <http://www.gnu.org/licenses/>.
+ */
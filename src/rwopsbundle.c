@@ -6,10 +6,19 @@
 #include <SDL_version.h>
 #include <errno.h>
 #include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 /* Our custom RWops type id. Not strictly needed, but it helps catching bugs if somehow we end up
  * trying to delete a different type of RWops. */
 #define CUSTOM_RWOPS_TYPE 3819859
+#define MAPPED_RWOPS_TYPE 3819860
 
 /* Media resource information for our custom RWops implementation. Media resources are embedded
  * inside media bundle files. They begin at 'startPos' and end at 'endPos' inside the 'file' bundle.
@@ -188,6 +197,234 @@ SDL_RWops* RWFromMediaBundle(FILE* mediaBundle, long resLength)
     return rwops;
 }
 
+/* Media resource information for the memory mapped RWops. 'mapping' and 'mappingLen' describe the
+ * whole mapped region, which starts at a page boundary. The resource itself begins at 'data'.
+ */
+typedef struct
+{
+    void* mapping;
+    size_t mappingLen;
+    const Uint8* data;
+    long size;
+    long pos;
+} MappedBundleInfo;
+
+static SDL_bool MappedRWOpsCheck(SDL_RWops* rwops)
+{
+    if (rwops->type != MAPPED_RWOPS_TYPE) {
+        SDL_SetError("Unrecognized RWops type %u", rwops->type);
+        return SDL_FALSE;
+    }
+    return SDL_TRUE;
+}
+
+#if SDL_VERSION_ATLEAST(1, 3, 0)
+static Sint64 MappedRWOpsSizeFunc(SDL_RWops* rwops)
+{
+    if (!MappedRWOpsCheck(rwops)) {
+        return -1;
+    }
+    return ((MappedBundleInfo*)rwops->hidden.unknown.data1)->size;
+}
+#endif
+
+#if SDL_VERSION_ATLEAST(1, 3, 0)
+static Sint64 MappedRWOpsSeekFunc(SDL_RWops* rwops, Sint64 offset, int whence)
+#else
+static int MappedRWOpsSeekFunc(SDL_RWops* rwops, int offset, int whence)
+#endif
+{
+    MappedBundleInfo* info;
+    long newPos;
+    if (!MappedRWOpsCheck(rwops)) {
+        return -1;
+    }
+    info = rwops->hidden.unknown.data1;
+    if (whence == RW_SEEK_CUR) {
+        newPos = info->pos + offset;
+    } else if (whence == RW_SEEK_SET) {
+        newPos = offset;
+    } else {
+        newPos = info->size + offset;
+    }
+    if (newPos < 0) {
+        SDL_SetError("Tried to seek before the start of the media resource");
+        return -1;
+    }
+    /* Like fseek(), allow seeking past the end. Reads will simply return nothing. */
+    info->pos = newPos;
+    return info->pos;
+}
+
+#if SDL_VERSION_ATLEAST(1, 3, 0)
+static size_t MappedRWOpsReadFunc(SDL_RWops* rwops, void* ptr, size_t size, size_t maxnum)
+#else
+static int MappedRWOpsReadFunc(SDL_RWops* rwops, void* ptr, int size, int maxnum)
+#endif
+{
+    MappedBundleInfo* info;
+    long bytesLeft;
+    if (!MappedRWOpsCheck(rwops)) {
+        return -1;
+    }
+    info = rwops->hidden.unknown.data1;
+    if (size == 0 || info->pos >= info->size) {
+        return 0;
+    }
+    bytesLeft = info->size - info->pos;
+    if ((long)(size * maxnum) > bytesLeft) {
+        maxnum = bytesLeft / size;
+    }
+    memcpy(ptr, info->data + info->pos, size * maxnum);
+    info->pos += size * maxnum;
+    return maxnum;
+}
+
+#if SDL_VERSION_ATLEAST(1, 3, 0)
+static size_t MappedRWOpsWriteFunc(SDL_RWops* rwops, const void* ptr, size_t size, size_t num)
+#else
+static int MappedRWOpsWriteFunc(SDL_RWops* rwops, const void* ptr, int size, int num)
+#endif
+{
+    (void)ptr;
+    (void)size;
+    (void)num;
+    if (!MappedRWOpsCheck(rwops)) {
+        return -1;
+    }
+    SDL_SetError("Media bundle files are not supposed to be written to");
+    return -1;
+}
+
+static int MappedRWOpsCloseFunc(SDL_RWops* rwops)
+{
+    MappedBundleInfo* info;
+    if (!MappedRWOpsCheck(rwops)) {
+        return -1;
+    }
+    info = rwops->hidden.unknown.data1;
+#ifdef _WIN32
+    UnmapViewOfFile(info->mapping);
+#else
+    munmap(info->mapping, info->mappingLen);
+#endif
+    SDL_free(info);
+    SDL_FreeRW(rwops);
+    return 0;
+}
+
+/* Helper routine. Maps 'resLength' bytes starting at 'startPos' of the file at 'path' into
+ * memory. Returns SDL_FALSE if that's not possible.
+ */
+static SDL_bool MapResource(const char* path, long startPos, long resLength,
+                            MappedBundleInfo* info)
+{
+    long alignedStart;
+#ifdef _WIN32
+    SYSTEM_INFO sysInfo;
+    HANDLE file;
+    HANDLE mappingObj;
+    LARGE_INTEGER fileSize;
+
+    GetSystemInfo(&sysInfo);
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                       FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return SDL_FALSE;
+    }
+    if (!GetFileSizeEx(file, &fileSize) || startPos + resLength > fileSize.QuadPart) {
+        CloseHandle(file);
+        return SDL_FALSE;
+    }
+    mappingObj = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mappingObj == NULL) {
+        return SDL_FALSE;
+    }
+    /* Views must start at a multiple of the allocation granularity. */
+    alignedStart = startPos - startPos % (long)sysInfo.dwAllocationGranularity;
+    info->mappingLen = startPos - alignedStart + resLength;
+    info->mapping = MapViewOfFile(mappingObj, FILE_MAP_READ, 0, (DWORD)alignedStart,
+                                  info->mappingLen);
+    /* The view keeps the mapping object alive. */
+    CloseHandle(mappingObj);
+    if (info->mapping == NULL) {
+        return SDL_FALSE;
+    }
+#else
+    int fd;
+    struct stat st;
+
+    fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        return SDL_FALSE;
+    }
+    /* Accessing a mapping past the end of the file raises SIGBUS, so make sure it's all there. */
+    if (fstat(fd, &st) != 0 || startPos + resLength > st.st_size) {
+        close(fd);
+        return SDL_FALSE;
+    }
+    alignedStart = startPos - startPos % sysconf(_SC_PAGESIZE);
+    info->mappingLen = startPos - alignedStart + resLength;
+    info->mapping = mmap(NULL, info->mappingLen, PROT_READ, MAP_PRIVATE, fd, alignedStart);
+    /* The mapping stays valid after the descriptor is closed. */
+    close(fd);
+    if (info->mapping == MAP_FAILED) {
+        return SDL_FALSE;
+    }
+#endif
+    info->data = (const Uint8*)info->mapping + (startPos - alignedStart);
+    return SDL_TRUE;
+}
+
+SDL_RWops* RWFromMappedMediaBundle(FILE* mediaBundle, const char* path, long resLength)
+{
+    MappedBundleInfo* info;
+    SDL_RWops* rwops;
+    long startPos;
+
+    if (path == NULL || path[0] == '\0' || resLength <= 0) {
+        return RWFromMediaBundle(mediaBundle, resLength);
+    }
+    startPos = ftell(mediaBundle);
+    if (startPos == -1) {
+        return RWFromMediaBundle(mediaBundle, resLength);
+    }
+
+    info = SDL_malloc(sizeof *info);
+    if (info == NULL) {
+        return RWFromMediaBundle(mediaBundle, resLength);
+    }
+    if (!MapResource(path, startPos, resLength, info)) {
+        SDL_free(info);
+        return RWFromMediaBundle(mediaBundle, resLength);
+    }
+    rwops = SDL_AllocRW();
+    if (rwops == NULL) {
+#ifdef _WIN32
+        UnmapViewOfFile(info->mapping);
+#else
+        munmap(info->mapping, info->mappingLen);
+#endif
+        SDL_free(info);
+        return RWFromMediaBundle(mediaBundle, resLength);
+    }
+    info->size = resLength;
+    info->pos = 0;
+
+    rwops->hidden.unknown.data1 = info;
+#if SDL_VERSION_ATLEAST(1, 3, 0)
+    rwops->size = MappedRWOpsSizeFunc;
+#endif
+    rwops->seek = MappedRWOpsSeekFunc;
+    rwops->read = MappedRWOpsReadFunc;
+    rwops->write = MappedRWOpsWriteFunc;
+    rwops->close = MappedRWOpsCloseFunc;
+    rwops->type = MAPPED_RWOPS_TYPE;
+    fclose(mediaBundle);
+    return rwops;
+}
+
 /* Copyright (C) 2011-2019 Nikos Chantziaras
  *
  * This file is part of Hugor.
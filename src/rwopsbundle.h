@@ -17,6 +17,15 @@ extern "C" {
  */
 struct SDL_RWops* RWFromMediaBundle(FILE* mediaBundle, long resLength);
 
+/* Same as RWFromMediaBundle(), but the resource is read from a read-only memory mapping of the
+ * bundle file at 'path' instead of through 'mediaBundle'. Reads and seeks are then plain memory
+ * accesses. 'mediaBundle' is only used to obtain the position of the resource and is closed right
+ * away.
+ *
+ * If the file can't be mapped, this falls back to RWFromMediaBundle().
+ */
+struct SDL_RWops* RWFromMappedMediaBundle(FILE* mediaBundle, const char* path, long resLength);
+
 #ifdef __cplusplus
 }
 #endif
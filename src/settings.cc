@@ -29,6 +29,18 @@ extern "C" {
 #define SETT_SOUNDFONT QString::fromLatin1("soundfont")
 #define SETT_SYNTH_GAIN QString::fromLatin1("synthgain")
 #define SETT_USE_ADLMIDI QString::fromLatin1("useadlmidi")
+#define SETT_PICTURE_CACHE_SIZE QString::fromLatin1("pictureCacheSize")
+#define SETT_PREFETCH_PICTURES QString::fromLatin1("prefetchPictures")
+#define SETT_SAMPLE_CACHE_SIZE QString::fromLatin1("sampleCacheSize")
+#define SETT_MAX_CACHED_SAMPLE_SIZE QString::fromLatin1("maxCachedSampleSize")
+#define SETT_AUDIO_SAMPLE_RATE QString::fromLatin1("audioSampleRate")
+#define SETT_AUDIO_FORMAT QString::fromLatin1("audioFormat")
+#define SETT_AUDIO_CHANNELS QString::fromLatin1("audioChannels")
+#define SETT_AUDIO_PERIOD QString::fromLatin1("audioPeriod")
+#define SETT_MUSIC_RESAMPLER QString::fromLatin1("musicResampler")
+#define SETT_MUSIC_RESAMPLER_QUALITY QString::fromLatin1("musicResamplerQuality")
+#define SETT_SAMPLE_RESAMPLER QString::fromLatin1("sampleResampler")
+#define SETT_SAMPLE_RESAMPLER_QUALITY QString::fromLatin1("sampleResamplerQuality")
 #define SETT_MUTE_MINIMIZED QString::fromLatin1("muteWhenMinimized")
 #define SETT_SOUND_VOL QString::fromLatin1("soundVolume")
 #define SETT_MAIN_BG_COLOR QString::fromLatin1("mainbg")
@@ -55,6 +67,7 @@ extern "C" {
 #define SETT_FULLSCREEN_WIDTH QString::fromLatin1("fullscreenWidth")
 #define SETT_TEXT_CURSOR_SHAPE QString::fromLatin1("textCursorShape")
 #define SETT_TEXT_CURSOR_THICKNESS QString::fromLatin1("textCursorThickness")
+#define SETT_INPUT_QUEUE_SIZE QString::fromLatin1("inputQueueSize")
 #define SETT_START_FULLSCREEN QString::fromLatin1("startFullscreen")
 #define SETT_START_WINDOWED QString::fromLatin1("startWindowed")
 
@@ -86,6 +99,27 @@ void Settings::loadFromDisk(SettingsOverrides* ovr)
     soundfont = sett.value(SETT_SOUNDFONT, QString()).toString();
     synth_gain = sett.value(SETT_SYNTH_GAIN, 0.6f).toFloat();
     use_adlmidi = sett.value(SETT_USE_ADLMIDI, false).toBool();
+    picture_cache_size = sett.value(SETT_PICTURE_CACHE_SIZE, 64).toInt();
+    prefetch_pictures = sett.value(SETT_PREFETCH_PICTURES, false).toBool();
+    sample_cache_size = sett.value(SETT_SAMPLE_CACHE_SIZE, 32).toInt();
+    max_cached_sample_size = sett.value(SETT_MAX_CACHED_SAMPLE_SIZE, 1024).toInt();
+    audio_sample_rate = sett.value(SETT_AUDIO_SAMPLE_RATE, 44100).toInt();
+    audio_format =
+        sett.value(SETT_AUDIO_FORMAT, QVariant::fromValue(AudioFormat::Int16)).value<AudioFormat>();
+    audio_channels = sett.value(SETT_AUDIO_CHANNELS, 2).toInt();
+    audio_period = sett.value(SETT_AUDIO_PERIOD, 0).toInt();
+    music_resampler =
+        sett.value(SETT_MUSIC_RESAMPLER, QVariant::fromValue(ResamplerType::Automatic))
+            .value<ResamplerType>();
+    music_resampler_quality =
+        sett.value(SETT_MUSIC_RESAMPLER_QUALITY, QVariant::fromValue(ResamplerQuality::Balanced))
+            .value<ResamplerQuality>();
+    sample_resampler =
+        sett.value(SETT_SAMPLE_RESAMPLER, QVariant::fromValue(ResamplerType::Automatic))
+            .value<ResamplerType>();
+    sample_resampler_quality =
+        sett.value(SETT_SAMPLE_RESAMPLER_QUALITY, QVariant::fromValue(ResamplerQuality::Balanced))
+            .value<ResamplerQuality>();
     sett.endGroup();
 
     sett.beginGroup(SETT_COLORS_GRP);
@@ -131,6 +165,7 @@ void Settings::loadFromDisk(SettingsOverrides* ovr)
     cursor_shape = sett.value(SETT_TEXT_CURSOR_SHAPE, QVariant::fromValue(TextCursorShape::Ibeam))
                        .value<TextCursorShape>();
     cursor_thickness = sett.value(SETT_TEXT_CURSOR_THICKNESS, 1).toInt();
+    input_queue_size = sett.value(SETT_INPUT_QUEUE_SIZE, 1).toInt();
     sett.endGroup();
 
     sett.beginGroup(SETT_RECENT_GRP);
@@ -249,6 +284,20 @@ void Settings::saveToDisk()
     sett.setValue(SETT_SOUNDFONT, soundfont);
     sett.setValue(SETT_SYNTH_GAIN, synth_gain);
     sett.setValue(SETT_USE_ADLMIDI, use_adlmidi);
+    sett.setValue(SETT_PICTURE_CACHE_SIZE, picture_cache_size);
+    sett.setValue(SETT_PREFETCH_PICTURES, prefetch_pictures);
+    sett.setValue(SETT_SAMPLE_CACHE_SIZE, sample_cache_size);
+    sett.setValue(SETT_MAX_CACHED_SAMPLE_SIZE, max_cached_sample_size);
+    sett.setValue(SETT_AUDIO_SAMPLE_RATE, audio_sample_rate);
+    sett.setValue(SETT_AUDIO_FORMAT, QVariant::fromValue(audio_format).toString());
+    sett.setValue(SETT_AUDIO_CHANNELS, audio_channels);
+    sett.setValue(SETT_AUDIO_PERIOD, audio_period);
+    sett.setValue(SETT_MUSIC_RESAMPLER, QVariant::fromValue(music_resampler).toString());
+    sett.setValue(SETT_MUSIC_RESAMPLER_QUALITY,
+                  QVariant::fromValue(music_resampler_quality).toString());
+    sett.setValue(SETT_SAMPLE_RESAMPLER, QVariant::fromValue(sample_resampler).toString());
+    sett.setValue(SETT_SAMPLE_RESAMPLER_QUALITY,
+                  QVariant::fromValue(sample_resampler_quality).toString());
     sett.endGroup();
 
     sett.beginGroup(SETT_COLORS_GRP);
@@ -274,6 +323,7 @@ void Settings::saveToDisk()
     sett.setValue(SETT_SCRIPT_WRAP, script_wrap);
     sett.setValue(SETT_TEXT_CURSOR_SHAPE, QVariant::fromValue(cursor_shape).toString());
     sett.setValue(SETT_TEXT_CURSOR_THICKNESS, cursor_thickness);
+    sett.setValue(SETT_INPUT_QUEUE_SIZE, input_queue_size);
     sett.endGroup();
 
     sett.beginGroup(SETT_RECENT_GRP);
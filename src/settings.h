@@ -19,6 +19,32 @@ public:
     };
     Q_ENUM(TextCursorShape)
 
+    enum class AudioFormat
+    {
+        Int16,
+        Int32,
+        Float32,
+    };
+    Q_ENUM(AudioFormat)
+
+    enum class ResamplerType
+    {
+        Automatic,
+        Speex,
+        Sdl,
+        Src,
+        Soxr,
+    };
+    Q_ENUM(ResamplerType)
+
+    enum class ResamplerQuality
+    {
+        Fast,
+        Balanced,
+        Best,
+    };
+    Q_ENUM(ResamplerQuality)
+
     Settings()
         : video_sys_error(false)
     {}
@@ -37,6 +63,21 @@ public:
     QString soundfont;
     float synth_gain;
     bool use_adlmidi;
+    int picture_cache_size;
+    bool prefetch_pictures;
+    int sample_cache_size;
+    int max_cached_sample_size;
+    int audio_sample_rate;
+    AudioFormat audio_format;
+    int audio_channels;
+    // Audio device period in frames. 0 means start small and grow it when the device underruns.
+    int audio_period;
+    // Resamplers for music and sound effects. The quality is ignored for the automatic type, which
+    // picks a resampler for each sound depending on what it's used for.
+    ResamplerType music_resampler;
+    ResamplerQuality music_resampler_quality;
+    ResamplerType sample_resampler;
+    ResamplerQuality sample_resampler_quality;
 
     QColor main_text_color;
     QColor main_bg_color;
@@ -53,6 +94,7 @@ public:
     int script_wrap;
     TextCursorShape cursor_shape;
     int cursor_thickness;
+    int input_queue_size;
 
     bool ask_for_gamefile;
     QString last_file_open_dir;
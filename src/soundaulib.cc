@@ -2,14 +2,25 @@
 #include "hugodefs.h"
 #include "hugohandlers.h"
 
+#include <QCache>
 #include <QDebug>
 #include <QFile>
+#include <QFileInfo>
 #include <QResource>
+#include <QRunnable>
+#include <QSet>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
 #include <SDL.h>
 #include <SDL_audio.h>
 #include <algorithm>
 #include <array>
 #include <cmath>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <vector>
 
 #include "Aulib/DecoderAdlmidi.h"
 #include "Aulib/DecoderFluidsynth.h"
@@ -18,7 +29,6 @@
 #include "Aulib/DecoderOpenmpt.h"
 #include "Aulib/DecoderSndfile.h"
 #include "Aulib/DecoderXmp.h"
-#include "Aulib/ResamplerSpeex.h"
 #include "Aulib/Stream.h"
 #include "Aulib/Processor.h"
 #include "aulib.h"
@@ -28,25 +38,191 @@ extern "C" {
 }
 #include "hugorfile.h"
 #include "oplvolumebooster.h"
+#include "pcmdecoder.h"
+#include "resamplerfactory.h"
 #include "rwopsbundle.h"
 #include "settings.h"
 #include "synthfactory.h"
+#include "util.h"
+
+using namespace std::chrono_literals;
+
+// How long music takes to fade out when it's stopped or replaced, and to fade in when it replaces
+// music that is still fading out.
+static constexpr auto MUSIC_FADE_TIME = 1500ms;
+
+// Frame sizes the automatic audio period moves between, and how often we check for underruns.
+static constexpr int MIN_AUTO_AUDIO_PERIOD = 512;
+static constexpr int MAX_AUTO_AUDIO_PERIOD = 4096;
+static constexpr auto UNDERRUN_CHECK_INTERVAL = 2s;
+
+// How often audio performance statistics are logged when the HUGOR_AUDIO_STATS environment
+// variable is set.
+static constexpr auto AUDIO_STATS_INTERVAL = 5s;
+
+// Sound effects play on a fixed set of voices, so that they can overlap.
+static constexpr int SAMPLE_VOICE_COUNT = 8;
+
+// Samples that are small enough to be cached are still streamed if they decode to more than this.
+static constexpr auto MAX_PREDECODED_SAMPLE_LENGTH = 10s;
 
 // Current music and sample volumes. Needed to restore the volumes after muting them.
 static int currentMusicVol = 100;
 static int currentSampleVol = 100;
 
-// We only play one music and one sample track at a time, so it's enough to make these static.
+// We only play one music track at a time, so it's enough to make this static.
 static std::unique_ptr<Aulib::Stream>& musicStream()
 {
     static auto p = std::unique_ptr<Aulib::Stream>();
     return p;
 }
 
-static std::unique_ptr<Aulib::Stream>& sampleStream()
+// Music streams that were stopped or replaced and are still fading out.
+static std::vector<std::unique_ptr<Aulib::Stream>>& fadingMusicStreams()
 {
-    static auto p = std::unique_ptr<Aulib::Stream>();
-    return p;
+    static auto v = std::vector<std::unique_ptr<Aulib::Stream>>();
+    return v;
+}
+
+// Music decoders are created and opened in a worker thread. Every music change bumps the
+// generation, so that music which finishes loading after it was superseded can be dropped.
+static int musicGeneration = 0;
+static bool isMusicLoading = false;
+
+// Music that finished loading, keyed by generation, until the main thread picks it up.
+// closeSoundEngine() drops whatever is left, so that no stream outlives the audio library.
+struct LoadedMusic final
+{
+    std::unique_ptr<Aulib::Stream> stream;
+    Aulib::DecoderFluidsynth* fsynth = nullptr;
+};
+
+static std::mutex loadedMusicMutex;
+
+static std::map<int, LoadedMusic>& loadedMusic()
+{
+    static auto m = std::map<int, LoadedMusic>();
+    return m;
+}
+
+// Also decodes samples for the cache.
+static QThreadPool& musicLoaderPool()
+{
+    static auto pool = [] {
+        auto p = std::make_unique<QThreadPool>();
+        // Load one track at a time, in the order they were requested.
+        p->setMaxThreadCount(1);
+        return p;
+    }();
+    return *pool;
+}
+
+static bool isSoundMuted = false;
+
+// Decoded samples, so that replaying them needs no I/O or decoding. The cost is in KiB.
+struct CachedSample final
+{
+    std::shared_ptr<const PcmBuffer> pcm;
+};
+
+static QCache<QString, CachedSample>& sampleCache()
+{
+    static auto cache = QCache<QString, CachedSample>();
+    return cache;
+}
+
+// Keys of samples that are being decoded for the cache in the background.
+static QSet<QString>& pendingSamples()
+{
+    static auto set = QSet<QString>();
+    return set;
+}
+
+// Samples are identified by the file they are stored in and their position and length in it, like
+// pictures are in the picture cache. Returns an empty string for virtual files.
+static QString sampleCacheKey(const HugorFile& infile, const long reslength)
+{
+    if (infile.path().empty()) {
+        return {};
+    }
+    return QFileInfo(QString::fromLocal8Bit(infile.path().c_str())).absoluteFilePath()
+           + QLatin1Char(':') + QString::number(std::ftell(infile.get())) + QLatin1Char(':')
+           + QString::number(reslength);
+}
+
+struct SampleVoice final
+{
+    // Plays pre-decoded samples. Created once and then reused for every sample.
+    std::unique_ptr<Aulib::Stream> pcm_stream;
+    PcmDecoder* pcm_decoder = nullptr;
+    // Plays samples that were too long to pre-decode.
+    std::unique_ptr<Aulib::Stream> file_stream;
+    bool looping = false;
+    // Order in which voices were started, used to pick the voice to steal.
+    unsigned long serial = 0;
+
+    bool isPlaying() const
+    {
+        return (pcm_stream and pcm_stream->isPlaying())
+               or (file_stream and file_stream->isPlaying());
+    }
+
+    void stop()
+    {
+        if (pcm_stream) {
+            pcm_stream->stop();
+        }
+        file_stream.reset();
+    }
+
+    template <typename F>
+    void forEachStream(F func)
+    {
+        if (pcm_stream) {
+            func(*pcm_stream);
+        }
+        if (file_stream) {
+            func(*file_stream);
+        }
+    }
+};
+
+static std::array<SampleVoice, SAMPLE_VOICE_COUNT>& sampleVoices()
+{
+    static auto voices = std::array<SampleVoice, SAMPLE_VOICE_COUNT>();
+    return voices;
+}
+
+static unsigned long sampleVoiceSerial = 0;
+
+static void createSampleVoices()
+{
+    for (auto& voice : sampleVoices()) {
+        auto decoder = std::make_unique<PcmDecoder>();
+        voice.pcm_decoder = decoder.get();
+        voice.pcm_stream = std::make_unique<Aulib::Stream>(nullptr, std::move(decoder), false);
+        voice.pcm_stream->open();
+    }
+}
+
+// Returns a voice that isn't playing. If all of them are, the oldest one is stopped and returned.
+// Looping samples are usually background ambience, so voices that don't loop are stolen first.
+static SampleVoice& allocateSampleVoice()
+{
+    auto& voices = sampleVoices();
+    auto it = std::find_if(voices.begin(), voices.end(),
+                           [](const SampleVoice& voice) { return not voice.isPlaying(); });
+    if (it == voices.end()) {
+        it = std::min_element(voices.begin(), voices.end(),
+                              [](const SampleVoice& a, const SampleVoice& b) {
+                                  if (a.looping != b.looping) {
+                                      return not a.looping;
+                                  }
+                                  return a.serial < b.serial;
+                              });
+    }
+    it->stop();
+    return *it;
 }
 
 // We hold a pointer to the fluidsynth decoder so we can change the gain while the stream is
@@ -67,32 +243,175 @@ static float convertHugoVolume(int hugoVol)
     return (hugoVol / 100.f) * std::pow((float)hApp->settings().sound_volume / 100.f, 2.f);
 }
 
+static QTimer*& underrunTimer()
+{
+    static QTimer* p = nullptr;
+    return p;
+}
+
+// Doubles the audio period when the mixer reported underruns since the last check.
+static void checkAudioUnderruns()
+{
+    static int lastUnderrunCount = 0;
+
+    const int count = Aulib::underrunCount();
+    if (count == lastUnderrunCount) {
+        return;
+    }
+    const int period = Aulib::frameSize();
+    if (period < MAX_AUTO_AUDIO_PERIOD) {
+        const int newPeriod = std::min(period * 2, MAX_AUTO_AUDIO_PERIOD);
+        qDebug() << "Audio underruns detected, increasing audio period from" << period << "to"
+                 << newPeriod << "frames.";
+        if (not Aulib::setFrameSize(newPeriod)) {
+            qWarning("Unable to change audio period: %s", SDL_GetError());
+        }
+    }
+    lastUnderrunCount = Aulib::underrunCount();
+}
+
+static QTimer*& audioStatsTimer()
+{
+    static QTimer* p = nullptr;
+    return p;
+}
+
+// Adds up the stats of several streams. The lowest decode-ahead fill of any of them is kept.
+static void addStreamStats(Aulib::Stream::Stats& total, const Aulib::Stream::Stats& stats)
+{
+    total.decodeTime += stats.decodeTime;
+    total.resampleTime += stats.resampleTime;
+    total.processTime += stats.processTime;
+    total.mixTime += stats.mixTime;
+    if (stats.minAheadFill >= 0
+        and (total.minAheadFill < 0 or stats.minAheadFill < total.minAheadFill)) {
+        total.minAheadFill = stats.minAheadFill;
+    }
+}
+
+// Formats stream stats as a share of the stats interval. This is the CPU load each stage causes.
+static QString streamStatsString(const Aulib::Stream::Stats& stats)
+{
+    const auto percent = [](const std::chrono::microseconds time) {
+        return QString::number(100.0 * time / AUDIO_STATS_INTERVAL, 'f', 1) + QLatin1Char('%');
+    };
+    auto str = QStringLiteral("decode %1, resample %2, process %3, mix %4")
+                   .arg(percent(stats.decodeTime), percent(stats.resampleTime),
+                        percent(stats.processTime), percent(stats.mixTime));
+    if (stats.minAheadFill >= 0) {
+        str += QStringLiteral(", min ahead fill %1%").arg(stats.minAheadFill);
+    }
+    return str;
+}
+
+// Logs how long the audio callback takes compared to its deadline, and how much of the load
+// comes from music and from samples. Useful for finding out where audio dropouts come from.
+static void logAudioStats()
+{
+    const auto mixer = Aulib::takeMixerStats();
+    QStringList histogram;
+    for (const int count : mixer.callbackHistogram) {
+        histogram << QString::number(count);
+    }
+    qDebug().noquote() << "Audio mixer:"
+                       << QStringLiteral("%1 callbacks, deadline %2us, average %3us, max %4us, "
+                                         "histogram [%5], underruns %6, max lock %7us")
+                              .arg(mixer.callbacks)
+                              .arg(mixer.deadline.count())
+                              .arg(mixer.averageCallbackTime.count())
+                              .arg(mixer.maxCallbackTime.count())
+                              .arg(histogram.join(QLatin1Char(' ')))
+                              .arg(mixer.underruns)
+                              .arg(mixer.maxLockTime.count());
+
+    Aulib::Stream::Stats music;
+    if (musicStream()) {
+        addStreamStats(music, musicStream()->takeStats());
+    }
+    for (const auto& stream : fadingMusicStreams()) {
+        addStreamStats(music, stream->takeStats());
+    }
+    Aulib::Stream::Stats samples;
+    for (auto& voice : sampleVoices()) {
+        voice.forEachStream(
+            [&samples](Aulib::Stream& stream) { addStreamStats(samples, stream.takeStats()); });
+    }
+    qDebug().noquote() << "Audio music:" << streamStatsString(music);
+    qDebug().noquote() << "Audio samples:" << streamStatsString(samples);
+}
+
+static SDL_AudioFormat toSdlFormat(const Settings::AudioFormat format)
+{
+    switch (format) {
+    case Settings::AudioFormat::Int32:
+        return AUDIO_S32SYS;
+    case Settings::AudioFormat::Float32:
+        // The mixer works in float, so this doesn't need any sample conversion.
+        return AUDIO_F32SYS;
+    case Settings::AudioFormat::Int16:
+        break;
+    }
+    return AUDIO_S16SYS;
+}
+
 void initSoundEngine()
 {
-    // Initialize audio with 44.1kHz, 16 bit, 2 channels (stereo) and a 4k chunk size.
-    // TODO: Make this configurable?
-    if (not Aulib::init(44100, AUDIO_S16SYS, 2, 4096)) {
+    const Settings& sett = hApp->settings();
+    const int period = sett.audio_period > 0 ? sett.audio_period : MIN_AUTO_AUDIO_PERIOD;
+
+    if (not Aulib::init(sett.audio_sample_rate, toSdlFormat(sett.audio_format),
+                        sett.audio_channels, period)) {
         qWarning("Unable to initialize audio: %s", SDL_GetError());
         exit(1);
     }
+    createSampleVoices();
+    underrunTimer() = new QTimer;
+    underrunTimer()->setInterval(
+        std::chrono::duration_cast<std::chrono::milliseconds>(UNDERRUN_CHECK_INTERVAL).count());
+    QObject::connect(underrunTimer(), &QTimer::timeout, checkAudioUnderruns);
+    if (sett.audio_period <= 0) {
+        underrunTimer()->start();
+    }
+    if (not qEnvironmentVariableIsEmpty("HUGOR_AUDIO_STATS")) {
+        Aulib::setStatsEnabled(true);
+        audioStatsTimer() = new QTimer;
+        audioStatsTimer()->setInterval(
+            std::chrono::duration_cast<std::chrono::milliseconds>(AUDIO_STATS_INTERVAL).count());
+        QObject::connect(audioStatsTimer(), &QTimer::timeout, logAudioStats);
+        audioStatsTimer()->start();
+    }
 }
 
 void closeSoundEngine()
 {
+    delete underrunTimer();
+    underrunTimer() = nullptr;
+    delete audioStatsTimer();
+    audioStatsTimer() = nullptr;
+    ++musicGeneration;
+    musicLoaderPool().waitForDone();
+    {
+        std::lock_guard<std::mutex> lock(loadedMusicMutex);
+        loadedMusic().clear();
+    }
+    pendingSamples().clear();
+    fadingMusicStreams().clear();
     if (musicStream()) {
         musicStream()->stop();
         musicStream().reset();
     }
-    if (sampleStream()) {
-        sampleStream()->stop();
-        sampleStream().reset();
+    for (auto& voice : sampleVoices()) {
+        voice.stop();
+        voice = SampleVoice();
     }
+    sampleCache().clear();
     Aulib::quit();
     SDL_Quit();
 }
 
 void muteSound(bool mute)
 {
+    isSoundMuted = mute;
     if (musicStream()) {
         if (mute) {
             musicStream()->mute();
@@ -100,13 +419,22 @@ void muteSound(bool mute)
             musicStream()->unmute();
         }
     }
-    if (sampleStream()) {
+    for (const auto& stream : fadingMusicStreams()) {
         if (mute) {
-            sampleStream()->mute();
+            stream->mute();
         } else {
-            sampleStream()->unmute();
+            stream->unmute();
         }
     }
+    for (auto& voice : sampleVoices()) {
+        voice.forEachStream([mute](Aulib::Stream& stream) {
+            if (mute) {
+                stream.mute();
+            } else {
+                stream.unmute();
+            }
+        });
+    }
 }
 
 void updateMusicVolume()
@@ -126,121 +454,383 @@ void updateSynthGain()
     }
 }
 
+void updateAudioPeriod()
+{
+    if (underrunTimer() == nullptr) {
+        return;
+    }
+    const int period = hApp->settings().audio_period;
+    if (period <= 0) {
+        underrunTimer()->start();
+        return;
+    }
+    underrunTimer()->stop();
+    if (period != Aulib::frameSize() and not Aulib::setFrameSize(period)) {
+        qWarning("Unable to set audio period to %d frames: %s", period, SDL_GetError());
+    }
+}
+
 bool isMusicPlaying()
 {
-    return musicStream() and musicStream()->isPlaying();
+    return isMusicLoading or (musicStream() and musicStream()->isPlaying());
 }
 
 bool isSamplePlaying()
 {
-    return sampleStream() and sampleStream()->isPlaying();
+    const auto& voices = sampleVoices();
+    return std::any_of(voices.begin(), voices.end(),
+                       [](const SampleVoice& voice) { return voice.isPlaying(); });
 }
 
-static bool playStream(HUGO_FILE infile, long reslength, char loop_flag, bool isMusic)
+// Everything needed to create a music decoder without touching the settings from another thread.
+struct MusicDecoderParams final
 {
-    if ((isMusic and not hApp->settings().enable_music)
-        or (not isMusic and not hApp->settings().enable_sound_effects)) {
-        return false;
+    int resource_type;
+    bool use_adlmidi;
+    QString soundfont;
+    float synth_gain;
+    Settings::ResamplerType resampler;
+    Settings::ResamplerQuality resampler_quality;
+};
+
+// Creates the decoder for a music resource. Can be called from any thread.
+static std::unique_ptr<Aulib::Decoder>
+makeMusicDecoder(SDL_RWops* rwops, const MusicDecoderParams& params,
+                 std::shared_ptr<OplVolumeBooster>& processor, Aulib::DecoderFluidsynth*& fsynth)
+{
+    fsynth = nullptr;
+    switch (params.resource_type) {
+    case MIDI_R: {
+#if USE_DEC_ADLMIDI
+        if (params.use_adlmidi) {
+            processor = std::make_shared<OplVolumeBooster>();
+            return makeAdlmidiDec();
+        }
+#endif
+        auto dec = makeFluidsynthDec(params.soundfont, params.synth_gain);
+        fsynth = dec.get();
+        return dec;
     }
+    case XM_R:
+    case S3M_R:
+    case MOD_R: {
+        using ModDec_type =
+#if USE_DEC_OPENMPT
+            Aulib::DecoderOpenmpt;
+#elif USE_DEC_XMP
+            Aulib::DecoderXmp;
+#elif USE_DEC_MODPLUG
+            Aulib::DecoderModplug;
+#endif
+        return std::make_unique<ModDec_type>();
+    }
+    case MP3_R: {
+        // A bug in the Hugo base code allows WAV files to be played in the music channel. The
+        // engine passes them as MP3_R. "Future Boy" is a known game that depends on this bug.
+        std::array<char, 5> head{};
+        const bool is_wav =
+            SDL_RWread(rwops, head.data(), 1, 4) == 4 and head == decltype(head){"RIFF"};
+        SDL_RWseek(rwops, 0, RW_SEEK_SET);
+        if (is_wav) {
+            return std::make_unique<Aulib::DecoderSndfile>();
+        }
+        return std::make_unique<Aulib::DecoderMpg123>();
+    }
+    default:
+        return nullptr;
+    }
+}
 
-    auto& stream = isMusic ? musicStream() : sampleStream();
-    std::unique_ptr<Aulib::Decoder> decoder;
-    std::shared_ptr<OplVolumeBooster> processor;
+// Fades out the current music and keeps it around until it's done. Streams that have already
+// faded out are destroyed.
+static void fadeOutMusic()
+{
+    auto& fading = fadingMusicStreams();
+    fading.erase(std::remove_if(fading.begin(), fading.end(),
+                                [](const std::unique_ptr<Aulib::Stream>& s) {
+                                    return not s->isPlaying();
+                                }),
+                 fading.end());
 
-    if (stream) {
-        stream->stop();
-        stream.reset();
+    if (not musicStream()) {
+        return;
     }
+    fsynthDec() = nullptr;
+    if (musicStream()->isPlaying()) {
+        musicStream()->stop(MUSIC_FADE_TIME);
+        fading.push_back(std::move(musicStream()));
+    } else {
+        musicStream().reset();
+    }
+}
 
-    // Create an RWops for the embedded media resource.
-    SDL_RWops* rwops = RWFromMediaBundle(infile->get(), reslength);
-    if (rwops == nullptr) {
+// Starts a music stream that was loaded in the background, unless it's been superseded.
+static void startLoadedMusic(const int generation, const bool loop)
+{
+    LoadedMusic loaded;
+    {
+        std::lock_guard<std::mutex> lock(loadedMusicMutex);
+        const auto it = loadedMusic().find(generation);
+        // Already dropped by closeSoundEngine().
+        if (it == loadedMusic().end()) {
+            return;
+        }
+        loaded = std::move(it->second);
+        loadedMusic().erase(it);
+    }
+    if (generation != musicGeneration) {
+        return;
+    }
+    isMusicLoading = false;
+    if (not loaded.stream or not hApp->settings().enable_music) {
+        return;
+    }
+
+    fadeOutMusic();
+    // Only fade in if we're replacing music that is still audible.
+    const bool crossfade = not fadingMusicStreams().empty();
+    musicStream() = std::move(loaded.stream);
+    fsynthDec() = loaded.fsynth;
+    updateMusicVolume();
+    if (not musicStream()->play(loop ? 0 : 1, crossfade ? MUSIC_FADE_TIME : 0ms)) {
         qWarning() << "ERROR:" << SDL_GetError();
-        return false;
+        musicStream().reset();
+        fsynthDec() = nullptr;
     }
-    infile->release();
+}
 
-    if (not isMusic) {
-        decoder = std::make_unique<Aulib::DecoderSndfile>();
-    } else {
-        switch (resource_type) {
-        case MIDI_R: {
-#if USE_DEC_ADLMIDI
-            if (hApp->settings().use_adlmidi) {
-                decoder = makeAdlmidiDec();
-                fsynthDec() = nullptr;
-                processor = std::make_shared<OplVolumeBooster>();
-            } else {
-#endif
-                const auto& soundfont =
-                    hApp->settings().use_custom_soundfont ? hApp->settings().soundfont : QString();
-                auto dec = makeFluidsynthDec(soundfont, hApp->settings().synth_gain);
-                fsynthDec() = dec.get();
-                decoder = std::move(dec);
-#if USE_DEC_ADLMIDI
+class MusicLoadJob final: public QRunnable
+{
+public:
+    MusicLoadJob(const int generation, SDL_RWops* rwops, MusicDecoderParams params,
+                 const bool loop)
+        : generation_(generation)
+        , rwops_(rwops)
+        , params_(std::move(params))
+        , loop_(loop)
+    {}
+
+    void run() override
+    {
+        std::shared_ptr<OplVolumeBooster> processor;
+        Aulib::DecoderFluidsynth* fsynth = nullptr;
+        auto decoder = makeMusicDecoder(rwops_, params_, processor, fsynth);
+        std::unique_ptr<Aulib::Stream> stream;
+        if (decoder) {
+            stream = std::make_unique<Aulib::Stream>(
+                rwops_, std::move(decoder),
+                makeResampler(params_.resampler, params_.resampler_quality, ResamplerUse::Music),
+                true);
+            stream->addProcessor(std::move(processor));
+            // Music decoders (MIDI synths in particular) can take long enough to produce audio to
+            // cause dropouts when run inside the audio callback, so decode music in the background.
+            stream->setDecodeAhead(500ms, 100ms);
+            // If the synth can't keep up, play fewer voices (or OPL chips) rather than drop out.
+            stream->setLoadGovernor(true);
+            if (not stream->open()) {
+                qWarning() << "ERROR:" << SDL_GetError();
+                stream.reset();
+                fsynth = nullptr;
             }
-#endif
-            break;
+        } else {
+            qWarning() << "ERROR: Unknown music resource type";
+            SDL_RWclose(rwops_);
         }
-        case XM_R:
-        case S3M_R:
-        case MOD_R: {
-            using ModDec_type =
-#if USE_DEC_OPENMPT
-                Aulib::DecoderOpenmpt;
-#elif USE_DEC_XMP
-                Aulib::DecoderXmp;
-#elif USE_DEC_MODPLUG
-                Aulib::DecoderModplug;
-#endif
-            decoder = std::make_unique<ModDec_type>();
-            fsynthDec() = nullptr;
-            break;
+
+        {
+            std::lock_guard<std::mutex> lock(loadedMusicMutex);
+            loadedMusic()[generation_] = LoadedMusic{std::move(stream), fsynth};
         }
-        case MP3_R: {
-            // A bug in the Hugo base code allows WAV files to be played in the music channel. The
-            // engine passes them as MP3_R. "Future Boy" is a known game that depends on this bug.
-            std::array<char, 5> head{};
-            if (SDL_RWread(rwops, head.data(), 1, 4) == 4 and head == decltype(head){"RIFF"}) {
-                decoder = std::make_unique<Aulib::DecoderSndfile>();
-            } else {
-                decoder = std::make_unique<Aulib::DecoderMpg123>();
+        const int generation = generation_;
+        const bool loop = loop_;
+        postToMainThread([generation, loop] { startLoadedMusic(generation, loop); });
+    }
+
+private:
+    const int generation_;
+    SDL_RWops* const rwops_;
+    const MusicDecoderParams params_;
+    const bool loop_;
+};
+
+// Adds a sample that was decoded in the background to the cache.
+static void cacheDecodedSample(const QString& key, std::shared_ptr<const PcmBuffer> pcm)
+{
+    // Not pending anymore means the sound engine was closed in the meantime.
+    if (not pendingSamples().remove(key) or not pcm) {
+        return;
+    }
+    const auto cost = std::max<size_t>(1, pcm->size() * sizeof(float) / 1024);
+    sampleCache().insert(key, new CachedSample{std::move(pcm)}, static_cast<int>(cost));
+}
+
+class SampleDecodeJob final: public QRunnable
+{
+public:
+    SampleDecodeJob(QString key, std::string path, const long offset, const long reslength,
+                    const Settings::ResamplerType resampler,
+                    const Settings::ResamplerQuality resampler_quality)
+        : key_(std::move(key))
+        , path_(std::move(path))
+        , offset_(offset)
+        , reslength_(reslength)
+        , resampler_(resampler)
+        , resampler_quality_(resampler_quality)
+    {}
+
+    void run() override
+    {
+        // The file the sample is played from belongs to its stream, so we open our own.
+        SDL_RWops* rwops = nullptr;
+        if (FILE* file = std::fopen(path_.c_str(), "rb"); file != nullptr) {
+            if (std::fseek(file, offset_, SEEK_SET) == 0) {
+                rwops = RWFromMappedMediaBundle(file, path_.c_str(), reslength_);
+            }
+            if (rwops == nullptr) {
+                std::fclose(file);
             }
-            SDL_RWseek(rwops, 0, RW_SEEK_SET);
-            fsynthDec() = nullptr;
-            break;
         }
-        default:
-            qWarning() << "ERROR: Unknown music resource type";
+        std::shared_ptr<const PcmBuffer> pcm;
+        if (rwops != nullptr) {
+            pcm = PcmDecoder::decodeAll(
+                rwops, std::make_unique<Aulib::DecoderSndfile>(),
+                makeResampler(resampler_, resampler_quality_, ResamplerUse::PredecodedSample),
+                MAX_PREDECODED_SAMPLE_LENGTH);
+            SDL_RWclose(rwops);
+        }
+        const QString key = key_;
+        postToMainThread([key, pcm] { cacheDecodedSample(key, pcm); });
+    }
+
+private:
+    const QString key_;
+    const std::string path_;
+    const long offset_;
+    const long reslength_;
+    const Settings::ResamplerType resampler_;
+    const Settings::ResamplerQuality resampler_quality_;
+};
+
+static bool playSample(HUGO_FILE infile, long reslength, char loop_flag)
+{
+    const auto& sett = hApp->settings();
+    if (not sett.enable_sound_effects) {
+        return false;
+    }
+
+    // Small samples are decoded in full the first time they play and then kept in the cache.
+    auto& cache = sampleCache();
+    cache.setMaxCost(sett.sample_cache_size * 1024);
+    const bool predecode = reslength <= sett.max_cached_sample_size * 1024L;
+    const QString key = predecode ? sampleCacheKey(*infile, reslength) : QString();
+    std::shared_ptr<const PcmBuffer> pcm;
+    if (const CachedSample* cached = key.isEmpty() ? nullptr : cache.object(key)) {
+        pcm = cached->pcm;
+    }
+
+    SDL_RWops* rwops = nullptr;
+    if (not pcm) {
+        const std::string path = infile->path();
+        const long offset = std::ftell(infile->get());
+
+        // Create an RWops for the embedded media resource.
+        rwops = RWFromMappedMediaBundle(infile->get(), path.c_str(), reslength);
+        if (rwops == nullptr) {
+            qWarning() << "ERROR:" << SDL_GetError();
             return false;
         }
+        infile->release();
+
+        // Decoding the whole sample takes longer than opening a decoder, so the first time it's
+        // streamed while it gets decoded for the cache in the background.
+        if (not key.isEmpty() and not pendingSamples().contains(key)) {
+            pendingSamples().insert(key);
+            musicLoaderPool().start(new SampleDecodeJob(key, path, offset, reslength,
+                                                        sett.sample_resampler,
+                                                        sett.sample_resampler_quality));
+        }
     }
 
-    stream = std::make_unique<Aulib::Stream>(rwops, std::move(decoder),
-                                             std::make_unique<Aulib::ResamplerSpeex>(), true);
-    stream->addProcessor(std::move(processor));
-    if (stream->open()) {
-        // Start playing the stream. Loop forever if 'loop_flag' is true. Otherwise, just play it
-        // once.
-        if (isMusic) {
-            updateMusicVolume();
-        } else {
-            updateSoundVolume();
+    // Hugo only has a single sample channel, so a new looping sample replaces the previous one.
+    // Samples that don't loop are allowed to overlap.
+    if (loop_flag) {
+        for (auto& voice : sampleVoices()) {
+            if (voice.looping) {
+                voice.stop();
+            }
+        }
+    }
+
+    auto& voice = allocateSampleVoice();
+    voice.looping = loop_flag;
+    voice.serial = ++sampleVoiceSerial;
+
+    Aulib::Stream* stream = nullptr;
+    if (pcm) {
+        voice.pcm_decoder->setBuffer(std::move(pcm));
+        stream = voice.pcm_stream.get();
+    } else {
+        voice.file_stream = std::make_unique<Aulib::Stream>(
+            rwops, std::make_unique<Aulib::DecoderSndfile>(),
+            makeResampler(sett.sample_resampler, sett.sample_resampler_quality,
+                          ResamplerUse::StreamedSample),
+            true);
+        if (not voice.file_stream->open()) {
+            qWarning() << "ERROR:" << SDL_GetError();
+            voice.file_stream.reset();
+            return false;
         }
-        if (stream->play(loop_flag ? 0 : 1)) {
-            return true;
+        if (isSoundMuted) {
+            voice.file_stream->mute();
         }
+        stream = voice.file_stream.get();
+    }
+
+    // Start playing the stream. Loop forever if 'loop_flag' is true. Otherwise, just play it once.
+    updateSoundVolume();
+    if (stream->play(loop_flag ? 0 : 1)) {
+        return true;
     }
 
     qWarning() << "ERROR:" << SDL_GetError();
-    stream.reset();
-    fsynthDec() = nullptr;
+    voice.stop();
     return false;
 }
 
 void HugoHandlers::playmusic(HUGO_FILE infile, long reslength, char loop_flag, int* result)
 {
-    *result = playStream(infile, reslength, loop_flag, true);
+    *result = false;
+    if (not hApp->settings().enable_music) {
+        return;
+    }
+    if (resource_type != MIDI_R and resource_type != XM_R and resource_type != S3M_R
+        and resource_type != MOD_R and resource_type != MP3_R) {
+        qWarning() << "ERROR: Unknown music resource type";
+        return;
+    }
+
+    // Create an RWops for the embedded media resource.
+    SDL_RWops* rwops = RWFromMappedMediaBundle(infile->get(), infile->path().c_str(), reslength);
+    if (rwops == nullptr) {
+        qWarning() << "ERROR:" << SDL_GetError();
+        return;
+    }
+    infile->release();
+
+    // Creating and opening the decoder can take a while, so we don't make the engine wait for it.
+    // The engine stops the current music before playing new music, so it's already fading out
+    // while the new one loads.
+    const auto& sett = hApp->settings();
+    MusicDecoderParams params{resource_type,
+                              sett.use_adlmidi,
+                              sett.use_custom_soundfont ? sett.soundfont : QString(),
+                              sett.synth_gain,
+                              sett.music_resampler,
+                              sett.music_resampler_quality};
+    isMusicLoading = true;
+    musicLoaderPool().start(
+        new MusicLoadJob(++musicGeneration, rwops, std::move(params), loop_flag));
+    *result = true;
 }
 
 void HugoHandlers::musicvolume(int vol)
@@ -261,14 +851,15 @@ void HugoHandlers::musicvolume(int vol)
 
 void HugoHandlers::stopmusic()
 {
-    if (musicStream()) {
-        musicStream()->stop();
-    }
+    // Also cancel any music that is still loading.
+    ++musicGeneration;
+    isMusicLoading = false;
+    fadeOutMusic();
 }
 
 void HugoHandlers::playsample(HUGO_FILE infile, long reslength, char loop_flag, int* result)
 {
-    *result = playStream(infile, reslength, loop_flag, false);
+    *result = playSample(infile, reslength, loop_flag);
 }
 
 void HugoHandlers::samplevolume(int vol)
@@ -279,15 +870,16 @@ void HugoHandlers::samplevolume(int vol)
         vol = 100;
     }
     currentSampleVol = vol;
-    if (sampleStream()) {
-        sampleStream()->setVolume(convertHugoVolume(vol));
+    const float volume = convertHugoVolume(vol);
+    for (auto& voice : sampleVoices()) {
+        voice.forEachStream([volume](Aulib::Stream& stream) { stream.setVolume(volume); });
     }
 }
 
 void HugoHandlers::stopsample()
 {
-    if (sampleStream()) {
-        sampleStream()->stop();
+    for (auto& voice : sampleVoices()) {
+        voice.stop();
     }
 }
 
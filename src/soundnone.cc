@@ -24,6 +24,9 @@ void updateSoundVolume()
 void updateSynthGain()
 {}
 
+void updateAudioPeriod()
+{}
+
 bool isMusicPlaying()
 {
     return false;
@@ -12,10 +12,11 @@ std::unique_ptr<Aulib::DecoderFluidsynth> makeFluidsynthDec(const QString& sound
 {
     auto decoder = std::make_unique<Aulib::DecoderFluidsynth>();
 
+    // Soundfonts are cached by the decoder, so this is only slow the first time.
     if (soundfont.isNull()) {
         QResource res(QLatin1String(":/soundfont.sf2"));
         auto* rwops = SDL_RWFromConstMem(res.data(), res.size());
-        decoder->loadSoundfont(rwops);
+        decoder->loadSoundfont(rwops, res.fileName().toStdString());
     } else {
         decoder->loadSoundfont(soundfont.toStdString());
     }
@@ -27,10 +28,12 @@ std::unique_ptr<Aulib::DecoderFluidsynth> makeFluidsynthDec(const QString& sound
 std::unique_ptr<Aulib::DecoderAdlmidi> makeAdlmidiDec()
 {
     auto decoder = std::make_unique<Aulib::DecoderAdlmidi>();
-    QResource res(":/genmidi_gs.wopl");
-    const QByteArray data = res.isCompressed()
-                                ? qUncompress(res.data(), res.size())
-                                : QByteArray::fromRawData((const char*)res.data(), res.size());
+    // Only uncompress the bank once.
+    static const QByteArray data = [] {
+        QResource res(":/genmidi_gs.wopl");
+        return res.isCompressed() ? qUncompress(res.data(), res.size())
+                                  : QByteArray::fromRawData((const char*)res.data(), res.size());
+    }();
 
     decoder->setEmulator(Aulib::DecoderAdlmidi::Emulator::Dosbox);
     decoder->setChipAmount(6);
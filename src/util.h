@@ -14,6 +14,19 @@ static void runInMainThread(F&& fun)
                      Qt::BlockingQueuedConnection);
 }
 
+// Like runInMainThread(), but returns without waiting for the function to run.
+template<typename F>
+static void postToMainThread(F&& fun)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+    QMetaObject::invokeMethod(qApp, std::forward<F>(fun), Qt::QueuedConnection);
+#else
+    QObject tmp;
+    QObject::connect(&tmp, &QObject::destroyed, qApp, std::forward<F>(fun),
+                     Qt::QueuedConnection);
+#endif
+}
+
 #ifdef Q_OS_MAC
 /* Returns the macOS application bundle directory.
  */
@@ -290,7 +290,7 @@ bool VideoPlayer::loadVideo(HugorFile* src, long len, bool loop)
     }
 
     SDL_ClearError();
-    auto* rwops = RWFromMediaBundle(src->get(), len);
+    auto* rwops = RWFromMappedMediaBundle(src->get(), src->path().c_str(), len);
     if (rwops == nullptr) {
         QString msg(QLatin1String("Failed to open video data"));
         if (strlen(SDL_GetError()) == 0) {
@@ -2,29 +2,23 @@
 #include "vlcaudiodecoder.h"
 
 #include "aulib.h"
-#include <QDebug>
-#include <QMutexLocker>
+#include "sampleconv.h"
+#include <QtGlobal>
 #include <algorithm>
+#include <array>
+#include <cstring>
 
 void VlcAudioDecoder::pushSamples(const void* samples, unsigned count) noexcept
 {
     Q_ASSERT(samples != nullptr);
 
-    const auto* begin = static_cast<const int16_t*>(samples);
-    const auto* end = begin + count * getChannels();
-
-    QMutexLocker lock(&sample_buf_mutex_);
-    size_t needed_capacity = sample_buf_.size() + count * getChannels();
-    if (sample_buf_.capacity() < needed_capacity) {
-        sample_buf_.set_capacity(std::max(needed_capacity, sample_buf_.capacity() * 2));
-    }
-    sample_buf_.insert(sample_buf_.end(), begin, end);
+    pushed_ += sample_buf_.push(static_cast<const int16_t*>(samples),
+                                static_cast<int>(count) * getChannels());
 }
 
 void VlcAudioDecoder::discardPendingSamples() noexcept
 {
-    QMutexLocker lock(&sample_buf_mutex_);
-    sample_buf_.clear();
+    discard_mark_ = pushed_.load();
 }
 
 bool VlcAudioDecoder::open(SDL_RWops* rwops)
@@ -62,15 +56,33 @@ int VlcAudioDecoder::doDecoding(float buf[], int len, bool& callAgain)
 {
     callAgain = false;
 
-    QMutexLocker locker(&sample_buf_mutex_);
-    int count = std::min(len, (int)sample_buf_.size());
-    for (int i = 0; i < count; ++i) {
-        buf[i] = sample_buf_[i] / 32768.f;
+    // Everything up to the mark is already in the ring, so this never waits for the producer.
+    const uint64_t discard_mark = discard_mark_.load();
+    std::array<int16_t, 4096> trash;
+    while (pulled_ < discard_mark) {
+        const auto wanted = std::min<uint64_t>(discard_mark - pulled_, trash.size());
+        const int popped = sample_buf_.pop(trash.data(), static_cast<int>(wanted));
+        if (popped == 0) {
+            break;
+        }
+        pulled_ += popped;
+    }
+
+    // Convert in chunks that fit on the stack, so that we never allocate here.
+    std::array<int16_t, 1024> chunk;
+    int count = 0;
+    while (count < len) {
+        const int popped =
+            sample_buf_.pop(chunk.data(), std::min(len - count, static_cast<int>(chunk.size())));
+        if (popped == 0) {
+            break;
+        }
+        Aulib::s16ToFloat(buf + count, chunk.data(), popped);
+        count += popped;
+        pulled_ += popped;
     }
-    sample_buf_.erase_begin(count);
-    locker.unlock();
 
-    memset(buf + count, 0, (len - count) * sizeof(*buf));
+    std::memset(buf + count, 0, (len - count) * sizeof(*buf));
     return len;
 }
 
@@ -1,15 +1,23 @@
 // This is copyrighted software. More information is at the end of this file.
 #pragma once
 #include "Aulib/Decoder.h"
+#include "RingBuffer.h"
 
-#include <QMutex>
-#include <boost/circular_buffer.hpp>
+#include <atomic>
 #include <cstdint>
 
+/* Receives audio from libVLC and feeds it to an Aulib::Stream.
+ *
+ * libVLC pushes samples from its own thread while the audio callback pulls them, so they are
+ * passed through a lock-free ring. Neither side ever waits for the other.
+ */
 class VlcAudioDecoder final: public Aulib::Decoder
 {
 public:
+    // Called from the libVLC audio thread. Samples that don't fit into the ring are dropped.
     void pushSamples(const void* samples, unsigned count) noexcept;
+    // Can be called from any thread. The samples pushed so far are dropped the next time audio is
+    // pulled. Samples pushed after this call are kept.
     void discardPendingSamples() noexcept;
 
     bool open(SDL_RWops* rwops) override;
@@ -23,8 +31,12 @@ protected:
     int doDecoding(float buf[], int len, bool& callAgain) override;
 
 private:
-    boost::circular_buffer<int16_t> sample_buf_{131072};
-    QMutex sample_buf_mutex_;
+    RingBuffer<int16_t> sample_buf_{131072};
+    // Total samples that went into and out of the ring. A discard drops everything up to the
+    // amount that had been pushed when it was requested.
+    std::atomic<uint64_t> pushed_{0};
+    uint64_t pulled_ = 0;
+    std::atomic<uint64_t> discard_mark_{0};
 };
 
 /* Copyright (C) 2011-2019 Nikos Chantziaras